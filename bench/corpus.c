@@ -0,0 +1,348 @@
+#include "corpus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+
+// headroom past the requested size, enough for the longest unit
+#define CORPUS_SLACK (64 * 1024)
+
+static const char *corpus_kind_names[] = {
+    [CORPUS_MIXED] = "mixed",       [CORPUS_IDENTIFIERS] = "identifiers",
+    [CORPUS_NUMBERS] = "numbers",   [CORPUS_STRINGS] = "strings",
+    [CORPUS_COMMENTS] = "comments", [CORPUS_NESTING] = "nesting",
+    [CORPUS_ERRORS] = "errors",
+};
+
+static const char *corpus_keywords[] = {
+    "and", "class",  "else",  "false", "for",  "fun", "if",  "nil",
+    "or",  "print",  "return", "super", "this", "true", "var", "while",
+};
+
+struct corpus_writer_t {
+  char *data;
+  uint64_t length;
+  uint64_t capacity;
+  uint64_t state;
+  uint8_t failed;
+};
+
+const char *corpus_kind_name(enum corpus_kind_t kind) {
+  return kind < CORPUS_KIND_COUNT ? corpus_kind_names[kind] : "unknown";
+}
+
+enum corpus_kind_t corpus_kind_parse(const char *name) {
+  for (int kind = 0; kind < CORPUS_KIND_COUNT; kind++) {
+    if (strcmp(name, corpus_kind_names[kind]) == 0)
+      return (enum corpus_kind_t)kind;
+  }
+
+  return CORPUS_KIND_COUNT;
+}
+
+uint64_t corpus_parse_size(const char *text) {
+  char *end;
+  unsigned long long value = strtoull(text, &end, 10);
+
+  if (end == text)
+    return 0;
+
+  switch (*end) {
+  case '\0':
+    return value;
+  case 'k':
+  case 'K':
+    return end[1] == '\0' ? value << 10 : 0;
+  case 'm':
+  case 'M':
+    return end[1] == '\0' ? value << 20 : 0;
+  case 'g':
+  case 'G':
+    return end[1] == '\0' ? value << 30 : 0;
+  default:
+    return 0;
+  }
+}
+
+// xorshift64*, plenty for test data
+static uint64_t corpus_random(struct corpus_writer_t *w) {
+  w->state ^= w->state >> 12;
+  w->state ^= w->state << 25;
+  w->state ^= w->state >> 27;
+  return w->state * 0x2545F4914F6CDD1DULL;
+}
+
+static uint64_t corpus_below(struct corpus_writer_t *w, uint64_t bound) {
+  return (corpus_random(w) >> 11) % bound;
+}
+
+static void corpus_put_n(struct corpus_writer_t *w, const char *text,
+                         uint64_t length) {
+  if (w->length + length > w->capacity) {
+    uint64_t capacity = w->capacity * 2 + length;
+    char *grown = (char *)realloc(w->data, capacity);
+
+    if (grown == NULL) {
+      w->failed = 1;
+      return;
+    }
+
+    w->data = grown;
+    w->capacity = capacity;
+  }
+
+  memcpy(w->data + w->length, text, length);
+  w->length += length;
+}
+
+static void corpus_put(struct corpus_writer_t *w, const char *text) {
+  corpus_put_n(w, text, strlen(text));
+}
+
+static void corpus_put_char(struct corpus_writer_t *w, char c) {
+  corpus_put_n(w, &c, 1);
+}
+
+static void corpus_put_name(struct corpus_writer_t *w, uint64_t max_length) {
+  static const char head[] =
+      "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+  static const char tail[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+
+  uint64_t length = 1 + corpus_below(w, max_length);
+
+  corpus_put_char(w, head[corpus_below(w, sizeof(head) - 1)]);
+
+  for (uint64_t i = 1; i < length; i++)
+    corpus_put_char(w, tail[corpus_below(w, sizeof(tail) - 1)]);
+}
+
+// a quarter of the words are keywords, like real code
+static void corpus_put_word(struct corpus_writer_t *w) {
+  if (corpus_below(w, 4) == 0)
+    corpus_put(w, corpus_keywords[corpus_below(w, 16)]);
+  else
+    corpus_put_name(w, 12);
+}
+
+static void corpus_put_number(struct corpus_writer_t *w) {
+  uint64_t digits = 1 + corpus_below(w, corpus_below(w, 4) == 0 ? 20 : 5);
+
+  corpus_put_char(w, (char)('1' + corpus_below(w, 9)));
+
+  for (uint64_t i = 1; i < digits; i++)
+    corpus_put_char(w, (char)('0' + corpus_below(w, 10)));
+
+  if (corpus_below(w, 3) == 0) {
+    uint64_t decimals = 1 + corpus_below(w, 8);
+
+    corpus_put_char(w, '.');
+
+    for (uint64_t i = 0; i < decimals; i++)
+      corpus_put_char(w, (char)('0' + corpus_below(w, 10)));
+  }
+}
+
+static void corpus_put_text(struct corpus_writer_t *w, uint64_t length,
+                            int newlines) {
+  static const char text[] = "abcdefghijklmnopqrstuvwxyz     .,;:!?()-+*/=<>";
+
+  for (uint64_t i = 0; i < length; i++) {
+    if (newlines && corpus_below(w, 80) == 0)
+      corpus_put_char(w, '\n');
+    else
+      corpus_put_char(w, text[corpus_below(w, sizeof(text) - 1)]);
+  }
+}
+
+static void corpus_put_operator(struct corpus_writer_t *w) {
+  static const char *operators[] = {" + ", " - ", " * ", " / ", " == ",
+                                    " != ", " < ", " <= ", " > ", " >= "};
+
+  corpus_put(w, operators[corpus_below(w, 10)]);
+}
+
+static void corpus_mixed(struct corpus_writer_t *w) {
+  switch (corpus_below(w, 6)) {
+  case 0:
+    corpus_put(w, "var ");
+    corpus_put_name(w, 10);
+    corpus_put(w, " = ");
+    corpus_put_number(w);
+    corpus_put_operator(w);
+    corpus_put_name(w, 10);
+    corpus_put(w, ";\n");
+    break;
+  case 1:
+    corpus_put(w, "fun ");
+    corpus_put_name(w, 10);
+    corpus_put(w, "(a, b) {\n  return a + b * ");
+    corpus_put_number(w);
+    corpus_put(w, ";\n}\n");
+    break;
+  case 2:
+    corpus_put(w, "if (");
+    corpus_put_name(w, 8);
+    corpus_put(w, " >= ");
+    corpus_put_number(w);
+    corpus_put(w, ") {\n  print \"");
+    corpus_put_text(w, corpus_below(w, 40), 0);
+    corpus_put(w, "\";\n} else {\n  count = count - 1;\n}\n");
+    break;
+  case 3:
+    corpus_put(w, "while (i < ");
+    corpus_put_number(w);
+    corpus_put(w, ") { i = i + 1; }\n");
+    break;
+  case 4:
+    corpus_put(w, "// ");
+    corpus_put_text(w, corpus_below(w, 60), 0);
+    corpus_put_char(w, '\n');
+    break;
+  default:
+    corpus_put(w, "class ");
+    corpus_put_name(w, 10);
+    corpus_put(w, " < Base {\n  init() { this.value = nil; }\n}\n");
+    break;
+  }
+}
+
+static void corpus_identifiers(struct corpus_writer_t *w) {
+  static const char *separators[] = {" ", ".", ", ", "(", ") ", " = "};
+
+  for (int i = 0; i < 8; i++) {
+    corpus_put_word(w);
+    corpus_put(w, separators[corpus_below(w, 6)]);
+  }
+
+  corpus_put(w, ";\n");
+}
+
+static void corpus_numbers(struct corpus_writer_t *w) {
+  for (int i = 0; i < 10; i++) {
+    if (i > 0)
+      corpus_put_operator(w);
+
+    corpus_put_number(w);
+  }
+
+  corpus_put(w, ";\n");
+}
+
+static void corpus_strings(struct corpus_writer_t *w) {
+  corpus_put(w, "print \"");
+
+  // every few literals is an embedded JSON blob, which needs escapes
+  if (corpus_below(w, 8) == 0) {
+    uint64_t fields = 1 + corpus_below(w, 40);
+
+    corpus_put(w, "{");
+
+    for (uint64_t i = 0; i < fields; i++) {
+      corpus_put(w, i == 0 ? "\\\"" : ",\\n  \\\"");
+      corpus_put_name(w, 8);
+      corpus_put(w, "\\\": \\\"");
+      corpus_put_text(w, 4 + corpus_below(w, 40), 0);
+      corpus_put(w, "\\\"");
+    }
+
+    corpus_put(w, "}\";\n");
+    return;
+  }
+
+  corpus_put_text(w, 20 + corpus_below(w, 2000), corpus_below(w, 10) == 0);
+  corpus_put(w, "\";\n");
+}
+
+static void corpus_comments(struct corpus_writer_t *w) {
+  if (corpus_below(w, 8) == 0) {
+    corpus_put(w, "var x = 1;\n");
+    return;
+  }
+
+  corpus_put(w, "// ");
+  corpus_put_text(w, 40 + corpus_below(w, 160), 0);
+  corpus_put_char(w, '\n');
+}
+
+static void corpus_nesting(struct corpus_writer_t *w) {
+  uint64_t depth = 1 + corpus_below(w, 128);
+
+  for (uint64_t i = 0; i < depth; i++)
+    corpus_put(w, "{(");
+
+  corpus_put_name(w, 4);
+
+  for (uint64_t i = 0; i < depth; i++)
+    corpus_put(w, ")}");
+
+  corpus_put_char(w, '\n');
+}
+
+static void corpus_errors(struct corpus_writer_t *w) {
+  static const char unexpected[] = "@#$%^&|?~`[]\\:'";
+
+  for (int i = 0; i < 6; i++) {
+    corpus_put_word(w);
+    corpus_put_char(w, unexpected[corpus_below(w, sizeof(unexpected) - 1)]);
+    corpus_put_char(w, ' ');
+  }
+
+  corpus_put_char(w, '\n');
+}
+
+char *corpus_generate(enum corpus_kind_t kind, uint64_t size, uint64_t seed,
+                      uint64_t *length) {
+  struct corpus_writer_t w = {
+      .capacity = size + CORPUS_SLACK,
+      // xorshift must never be seeded with 0
+      .state = seed * 0x9E3779B97F4A7C15ULL + 1,
+  };
+
+  w.data = (char *)malloc(w.capacity);
+
+  if (w.data == NULL) {
+    LOG_ERROR("corpus_generate: error allocating %llu bytes",
+              (unsigned long long)w.capacity);
+    return NULL;
+  }
+
+  while (w.length < size && !w.failed) {
+    switch (kind) {
+    case CORPUS_IDENTIFIERS:
+      corpus_identifiers(&w);
+      break;
+    case CORPUS_NUMBERS:
+      corpus_numbers(&w);
+      break;
+    case CORPUS_STRINGS:
+      corpus_strings(&w);
+      break;
+    case CORPUS_COMMENTS:
+      corpus_comments(&w);
+      break;
+    case CORPUS_NESTING:
+      corpus_nesting(&w);
+      break;
+    case CORPUS_ERRORS:
+      corpus_errors(&w);
+      break;
+    default:
+      corpus_mixed(&w);
+      break;
+    }
+  }
+
+  if (kind == CORPUS_ERRORS)
+    corpus_put(&w, "\"never closed\n");
+
+  if (w.failed) {
+    LOG_ERROR("corpus_generate: error growing corpus buffer");
+    free(w.data);
+    return NULL;
+  }
+
+  *length = w.length;
+
+  return w.data;
+}
@@ -0,0 +1,39 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdint.h>
+
+// synthetic Lox inputs for benchmarking the scanner. every kind stresses a
+// different path; output is deterministic for a given seed
+enum corpus_kind_t {
+  // realistic mix of declarations, control flow, calls and comments
+  CORPUS_MIXED,
+  // long identifiers and keywords, few other tokens
+  CORPUS_IDENTIFIERS,
+  // integers and decimals of every length, plus arithmetic
+  CORPUS_NUMBERS,
+  // long (and some multi-line) string literals, a few of them with escapes
+  CORPUS_STRINGS,
+  // mostly // comments
+  CORPUS_COMMENTS,
+  // deeply nested blocks, calls and groupings
+  CORPUS_NESTING,
+  // unexpected characters everywhere and an unterminated string at the end
+  CORPUS_ERRORS,
+  CORPUS_KIND_COUNT
+};
+
+const char *corpus_kind_name(enum corpus_kind_t kind);
+
+// returns CORPUS_KIND_COUNT for an unknown name
+enum corpus_kind_t corpus_kind_parse(const char *name);
+
+// generates about size bytes (it stops at the first line boundary past size)
+// into a fresh malloc'd buffer. returns NULL on allocation failure
+char *corpus_generate(enum corpus_kind_t kind, uint64_t size, uint64_t seed,
+                      uint64_t *length);
+
+// "64", "4K", "16M", "1G"; returns 0 for anything else
+uint64_t corpus_parse_size(const char *text);
+
+#endif // CORPUS_H
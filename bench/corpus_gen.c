@@ -0,0 +1,37 @@
+// writes one synthetic corpus to stdout, for keeping inputs around or feeding
+// them to the interpreter itself
+//
+// usage: corpus_gen <kind> <size> [seed]
+//   kind: mixed, identifiers, numbers, strings, comments, nesting, errors
+//   size: bytes, with an optional K/M/G suffix
+
+#include "corpus.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: corpus_gen <kind> <size> [seed]\n");
+    return 1;
+  }
+
+  enum corpus_kind_t kind = corpus_kind_parse(argv[1]);
+  uint64_t size = corpus_parse_size(argv[2]);
+  uint64_t seed = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+
+  if (kind == CORPUS_KIND_COUNT || size == 0) {
+    fprintf(stderr, "Usage: corpus_gen <kind> <size> [seed]\n");
+    return 1;
+  }
+
+  uint64_t length;
+  char *corpus = corpus_generate(kind, size, seed, &length);
+
+  if (corpus == NULL)
+    return 1;
+
+  int ok = fwrite(corpus, 1, length, stdout) == length;
+  free(corpus);
+
+  return ok ? 0 : 1;
+}
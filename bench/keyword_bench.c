@@ -0,0 +1,122 @@
+// microbenchmark: perfect-hash keyword_lookup against the runtime-built
+// token_keyword_table the scanner used to go through
+//
+// usage: keyword_bench [lookups]
+
+#include "keyword.h"
+#include "token_keyword_table.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define WORD_POOL_SIZE 4096
+#define MAX_WORD_LENGTH 16
+
+struct word_t {
+  char text[MAX_WORD_LENGTH + 1];
+  uint64_t length;
+};
+
+static const char *keywords[] = {
+    "and", "class",  "else",  "false", "for",  "fun", "if",  "nil",
+    "or",  "print",  "return", "super", "this", "true", "var", "while",
+};
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// roughly what identifier-heavy code looks like: a third keywords, the rest
+// short names, some of them keyword prefixes/near misses
+static void fill_word_pool(struct word_t *pool, uint32_t seed) {
+  static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+
+  for (int i = 0; i < WORD_POOL_SIZE; i++) {
+    seed = seed * 1103515245u + 12345u;
+
+    if (seed % 3 == 0) {
+      const char *keyword = keywords[(seed >> 8) % 16];
+      pool[i].length = strlen(keyword);
+      memcpy(pool[i].text, keyword, pool[i].length + 1);
+      continue;
+    }
+
+    uint64_t length = 1 + (seed >> 8) % 10;
+
+    for (uint64_t j = 0; j < length; j++) {
+      seed = seed * 1103515245u + 12345u;
+      // identifiers can't start with a digit
+      pool[i].text[j] = alphabet[(seed >> 8) % (j == 0 ? 27 : 37)];
+    }
+
+    pool[i].text[length] = '\0';
+    pool[i].length = length;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t lookups = argc > 1 ? strtoull(argv[1], NULL, 10) : 50000000;
+
+  struct word_t *pool =
+      (struct word_t *)calloc(WORD_POOL_SIZE, sizeof(struct word_t));
+  fill_word_pool(pool, 42);
+
+  // setup cost the old scanner paid on every run
+  double setup_start = now_ns();
+
+  struct token_keyword_table *table = hashmap_create(64, NULL);
+  for (int i = 0; i < 16; i++) {
+    TokenType type = keyword_lookup(keywords[i], strlen(keywords[i]));
+    hashmap_put(table, (char *)keywords[i], type);
+  }
+
+  double setup_ns = now_ns() - setup_start;
+
+  // old path: terminate a copy of the lexeme, FNV-hash it, strcmp on probe
+  uint64_t hashmap_sum = 0;
+  double start = now_ns();
+
+  for (uint64_t i = 0; i < lookups; i++) {
+    struct word_t *word = &pool[i & (WORD_POOL_SIZE - 1)];
+    char copy[MAX_WORD_LENGTH + 1];
+
+    memcpy(copy, word->text, word->length);
+    copy[word->length] = '\0';
+
+    hashmap_sum += (uint64_t)hashmap_lookup(table, copy);
+  }
+
+  double hashmap_ns = now_ns() - start;
+
+  // new path: straight off the span
+  uint64_t keyword_sum = 0;
+  start = now_ns();
+
+  for (uint64_t i = 0; i < lookups; i++) {
+    struct word_t *word = &pool[i & (WORD_POOL_SIZE - 1)];
+    keyword_sum += (uint64_t)keyword_lookup(word->text, word->length);
+  }
+
+  double keyword_ns = now_ns() - start;
+
+  if (hashmap_sum != keyword_sum) {
+    fprintf(stderr, "keyword_bench: lookups disagree (%llu vs %llu)\n",
+            (unsigned long long)hashmap_sum, (unsigned long long)keyword_sum);
+    return 1;
+  }
+
+  printf("lookups:        %llu\n", (unsigned long long)lookups);
+  printf("hashmap setup:  %.0f ns\n", setup_ns);
+  printf("hashmap_lookup: %.2f ns/lookup\n", hashmap_ns / (double)lookups);
+  printf("keyword_lookup: %.2f ns/lookup\n", keyword_ns / (double)lookups);
+  printf("speedup:        %.2fx\n", hashmap_ns / keyword_ns);
+
+  hashmap_destroy(table);
+  free(pool);
+
+  return 0;
+}
@@ -0,0 +1,363 @@
+// scanner benchmark over synthetic corpora. times parser_parse, pulling the
+// same tokens one at a time with parser_next_token, and the print path
+// separately and reports throughput, allocations and peak RSS for each as
+// JSON on stdout, so runs from different versions can be diffed
+//
+// usage: lexbench [--corpus kind,...] [--sizes size,...] [--iterations N]
+//                 [--seed N] [--threads N]
+//   sizes take K/M/G suffixes and default to 1K,64K,1M,16M (1G works, given
+//   the memory); iterations default to as many as fit in half a second
+
+#include "corpus.h"
+#include "diagnostics.h"
+#include "memory_stats.h"
+#include "output.h"
+#include "parallel_parser.h"
+#include "parser.h"
+#include "simd.h"
+#include "token.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LEXBENCH_MAX_SIZES 16
+#define LEXBENCH_MIN_SECONDS 0.5
+#define LEXBENCH_MAX_ITERATIONS 1000
+#define LEXBENCH_OUTPUT_SIZE (256 * 1024)
+
+struct phase_result_t {
+  uint64_t iterations;
+  double best_seconds;
+  double total_seconds;
+  uint64_t allocations;
+  uint64_t allocated_bytes;
+  long peak_rss_kb;
+};
+
+struct lexbench_options_t {
+  uint8_t kinds[CORPUS_KIND_COUNT];
+  uint64_t sizes[LEXBENCH_MAX_SIZES];
+  uint32_t size_count;
+  uint64_t iterations;
+  uint64_t seed;
+  uint32_t threads;
+};
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// linux lets a process reset its own high water mark, which gives a peak per
+// phase rather than for the whole run. returns 0 where that isn't supported
+static int reset_peak_rss(void) {
+  int fd = open("/proc/self/clear_refs", O_WRONLY);
+
+  if (fd < 0)
+    return 0;
+
+  int ok = write(fd, "5", 1) == 1;
+  close(fd);
+
+  return ok;
+}
+
+static long peak_rss_kb(void) {
+  FILE *status = fopen("/proc/self/status", "r");
+  char line[256];
+  long peak = -1;
+
+  while (status != NULL && fgets(line, sizeof(line), status) != NULL) {
+    if (strncmp(line, "VmHWM:", 6) == 0) {
+      peak = strtol(line + 6, NULL, 10);
+      break;
+    }
+  }
+
+  if (status != NULL)
+    fclose(status);
+
+  if (peak < 0) {
+    // process-wide peak, still better than nothing
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    peak = usage.ru_maxrss;
+  }
+
+  return peak;
+}
+
+static struct memory_stats_t phase_begin(void) {
+  reset_peak_rss();
+  return memory_stats_snapshot();
+}
+
+static void phase_end(struct phase_result_t *result, double seconds,
+                      struct memory_stats_t before) {
+  result->iterations++;
+  result->total_seconds += seconds;
+
+  if (result->iterations == 1 || seconds < result->best_seconds)
+    result->best_seconds = seconds;
+
+  // every iteration starts cold, so the first one speaks for all of them
+  if (result->iterations == 1) {
+    struct memory_stats_t after = memory_stats_snapshot();
+
+    result->allocations = after.allocations - before.allocations;
+    result->allocated_bytes = after.allocated_bytes - before.allocated_bytes;
+    result->peak_rss_kb = peak_rss_kb();
+  }
+}
+
+static int phase_done(const struct phase_result_t *result,
+                      const struct lexbench_options_t *options) {
+  if (options->iterations > 0)
+    return result->iterations >= options->iterations;
+
+  return result->iterations >= LEXBENCH_MAX_ITERATIONS ||
+         (result->iterations >= 3 &&
+          result->total_seconds >= LEXBENCH_MIN_SECONDS);
+}
+
+// scans with a fresh parser each time, like a run of the interpreter. returns
+// the last iteration's parser so the print phase has tokens to work on
+static struct parser_t *bench_parse(const char *corpus, uint64_t length,
+                                    const struct lexbench_options_t *options,
+                                    struct phase_result_t *result) {
+  struct parser_t *parser = NULL;
+  struct diagnostics_t *diagnostics = diagnostics_create();
+
+  while (!phase_done(result, options)) {
+    if (parser != NULL)
+      parser_destroy(parser);
+
+    diagnostics_clear(diagnostics);
+
+    struct memory_stats_t before = phase_begin();
+
+    double start = now_seconds();
+
+    parser = parser_create(NULL);
+    // the errors corpus would otherwise spend its time in stderr
+    parser->diagnostics = diagnostics;
+    parallel_parser_parse(parser, corpus, length, options->threads);
+
+    phase_end(result, now_seconds() - start, before);
+  }
+
+  parser->diagnostics = NULL;
+  diagnostics_destroy(diagnostics);
+
+  return parser;
+}
+
+// the iterator keeps only the lookahead around, so next to the parse phase
+// this shows what materializing the whole stream costs
+static void bench_pull(const char *corpus, uint64_t length,
+                       const struct lexbench_options_t *options,
+                       struct phase_result_t *result) {
+  struct diagnostics_t *diagnostics = diagnostics_create();
+
+  while (!phase_done(result, options)) {
+    diagnostics_clear(diagnostics);
+
+    struct memory_stats_t before = phase_begin();
+
+    double start = now_seconds();
+
+    struct parser_t *parser = parser_create(NULL);
+    struct token_entry_t entry;
+
+    parser->diagnostics = diagnostics;
+    parser_begin(parser, corpus, length);
+
+    while (parser_next_token(parser, &entry))
+      ;
+
+    parser_destroy(parser);
+
+    phase_end(result, now_seconds() - start, before);
+  }
+
+  diagnostics_destroy(diagnostics);
+}
+
+static void bench_print(struct parser_t *parser, const char *corpus,
+                        const struct lexbench_options_t *options,
+                        struct phase_result_t *result) {
+  int fd = open("/dev/null", O_WRONLY);
+  struct token_stream_t *tokens = parser_get_tokens(parser);
+
+  while (!phase_done(result, options)) {
+    struct memory_stats_t before = phase_begin();
+
+    double start = now_seconds();
+
+    struct output_t *out = output_create(fd, LEXBENCH_OUTPUT_SIZE);
+
+    for (uint64_t i = 0; i < tokens->size; i++) {
+      struct token_entry_t entry = token_stream_get(tokens, i);
+      print_token_entry(out, corpus, &entry);
+    }
+
+    output_destroy(out);
+
+    phase_end(result, now_seconds() - start, before);
+  }
+
+  close(fd);
+}
+
+static void print_phase(const char *name, const struct phase_result_t *result,
+                        uint64_t bytes, uint64_t tokens) {
+  double seconds = result->best_seconds > 0 ? result->best_seconds : 1e-9;
+
+  printf("      \"%s\": {\n", name);
+  printf("        \"iterations\": %llu,\n",
+         (unsigned long long)result->iterations);
+  printf("        \"seconds\": %.9f,\n", result->best_seconds);
+  printf("        \"mean_seconds\": %.9f,\n",
+         result->total_seconds / (double)result->iterations);
+  printf("        \"mb_per_s\": %.3f,\n", (double)bytes / 1e6 / seconds);
+  printf("        \"tokens_per_s\": %.1f,\n", (double)tokens / seconds);
+  printf("        \"ns_per_token\": %.3f,\n",
+         tokens > 0 ? seconds * 1e9 / (double)tokens : 0.0);
+  printf("        \"allocations\": %llu,\n",
+         (unsigned long long)result->allocations);
+  printf("        \"allocated_bytes\": %llu,\n",
+         (unsigned long long)result->allocated_bytes);
+  printf("        \"peak_rss_kb\": %ld\n", result->peak_rss_kb);
+  printf("      }");
+}
+
+static int parse_kinds(char *list, struct lexbench_options_t *options) {
+  memset(options->kinds, 0, sizeof(options->kinds));
+
+  for (char *name = strtok(list, ","); name != NULL;
+       name = strtok(NULL, ",")) {
+    enum corpus_kind_t kind = corpus_kind_parse(name);
+
+    if (kind == CORPUS_KIND_COUNT) {
+      fprintf(stderr, "lexbench: unknown corpus %s\n", name);
+      return 0;
+    }
+
+    options->kinds[kind] = 1;
+  }
+
+  return 1;
+}
+
+static int parse_sizes(char *list, struct lexbench_options_t *options) {
+  options->size_count = 0;
+
+  for (char *size = strtok(list, ","); size != NULL;
+       size = strtok(NULL, ",")) {
+    uint64_t bytes = corpus_parse_size(size);
+
+    if (bytes == 0 || options->size_count == LEXBENCH_MAX_SIZES) {
+      fprintf(stderr, "lexbench: bad size %s\n", size);
+      return 0;
+    }
+
+    options->sizes[options->size_count++] = bytes;
+  }
+
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  struct lexbench_options_t options = {
+      .sizes = {1 << 10, 64 << 10, 1 << 20, 16 << 20},
+      .size_count = 4,
+      .seed = 1,
+      .threads = 1,
+  };
+
+  memset(options.kinds, 1, sizeof(options.kinds));
+
+  for (int i = 1; i < argc; i++) {
+    int has_value = i + 1 < argc;
+
+    if (strcmp(argv[i], "--corpus") == 0 && has_value) {
+      if (!parse_kinds(argv[++i], &options))
+        return 1;
+    } else if (strcmp(argv[i], "--sizes") == 0 && has_value) {
+      if (!parse_sizes(argv[++i], &options))
+        return 1;
+    } else if (strcmp(argv[i], "--iterations") == 0 && has_value) {
+      options.iterations = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+      options.seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+      options.threads = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else {
+      fprintf(stderr, "Usage: lexbench [--corpus kind,...] [--sizes size,...] "
+                      "[--iterations N] [--seed N] [--threads N]\n");
+      return 1;
+    }
+  }
+
+  printf("{\n");
+  printf("  \"benchmark\": \"lexbench\",\n");
+  printf("  \"simd\": \"%s\",\n", simd_implementation());
+  printf("  \"threads\": %u,\n", options.threads);
+  printf("  \"seed\": %llu,\n", (unsigned long long)options.seed);
+  printf("  \"results\": [");
+
+  int first = 1;
+
+  for (int kind = 0; kind < CORPUS_KIND_COUNT; kind++) {
+    if (!options.kinds[kind])
+      continue;
+
+    for (uint32_t s = 0; s < options.size_count; s++) {
+      uint64_t length;
+      char *corpus = corpus_generate((enum corpus_kind_t)kind,
+                                     options.sizes[s], options.seed, &length);
+
+      if (corpus == NULL)
+        return 1;
+
+      struct phase_result_t parse = {0};
+      struct phase_result_t pull = {0};
+      struct phase_result_t print = {0};
+
+      struct parser_t *parser = bench_parse(corpus, length, &options, &parse);
+      bench_pull(corpus, length, &options, &pull);
+      bench_print(parser, corpus, &options, &print);
+
+      uint64_t tokens = parser_get_tokens(parser)->size;
+
+      printf("%s\n    {\n", first ? "" : ",");
+      printf("      \"corpus\": \"%s\",\n",
+             corpus_kind_name((enum corpus_kind_t)kind));
+      printf("      \"size\": %llu,\n", (unsigned long long)options.sizes[s]);
+      printf("      \"bytes\": %llu,\n", (unsigned long long)length);
+      printf("      \"tokens\": %llu,\n", (unsigned long long)tokens);
+      printf("      \"errors\": %s,\n", parser->error ? "true" : "false");
+      print_phase("parse", &parse, length, tokens);
+      printf(",\n");
+      print_phase("pull", &pull, length, tokens);
+      printf(",\n");
+      print_phase("print", &print, length, tokens);
+      printf("\n    }");
+      fflush(stdout);
+
+      first = 0;
+
+      parser_destroy(parser);
+      free(corpus);
+    }
+  }
+
+  printf("\n  ]\n}\n");
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+#ifndef LOX_H
+#define LOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// liblox: the scanner as a library. a lexer turns a buffer into tokens and
+// hands them to a sink in batches, nothing is printed. there's no global
+// state and the library never writes to stderr (diagnostics go to a sink of
+// their own), so separate lexers can run on separate threads. a single lexer
+// is not meant to be shared between threads
+//
+// only this header is stable; everything else under src/ is internal
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// bumped whenever something below changes incompatibly
+#define LOX_API_VERSION 3
+
+// the numbering never changes within an API version
+enum lox_token_type_t {
+  LOX_TOKEN_LEFT_PAREN,
+  LOX_TOKEN_RIGHT_PAREN,
+  LOX_TOKEN_LEFT_BRACE,
+  LOX_TOKEN_RIGHT_BRACE,
+  LOX_TOKEN_COMMA,
+  LOX_TOKEN_DOT,
+  LOX_TOKEN_MINUS,
+  LOX_TOKEN_PLUS,
+  LOX_TOKEN_SEMICOLON,
+  LOX_TOKEN_SLASH,
+  LOX_TOKEN_STAR,
+
+  LOX_TOKEN_BANG,
+  LOX_TOKEN_BANG_EQUAL,
+  LOX_TOKEN_EQUAL,
+  LOX_TOKEN_EQUAL_EQUAL,
+  LOX_TOKEN_GREATER,
+  LOX_TOKEN_GREATER_EQUAL,
+  LOX_TOKEN_LESS,
+  LOX_TOKEN_LESS_EQUAL,
+
+  LOX_TOKEN_IDENTIFIER,
+  LOX_TOKEN_STRING,
+  LOX_TOKEN_NUMBER,
+
+  LOX_TOKEN_AND,
+  LOX_TOKEN_CLASS,
+  LOX_TOKEN_ELSE,
+  LOX_TOKEN_FALSE,
+  LOX_TOKEN_FUN,
+  LOX_TOKEN_FOR,
+  LOX_TOKEN_IF,
+  LOX_TOKEN_NIL,
+  LOX_TOKEN_OR,
+  LOX_TOKEN_PRINT,
+  LOX_TOKEN_RETURN,
+  LOX_TOKEN_SUPER,
+  LOX_TOKEN_THIS,
+  LOX_TOKEN_TRUE,
+  LOX_TOKEN_VAR,
+  LOX_TOKEN_WHILE,
+
+  LOX_TOKEN_EOF
+};
+
+// what lox_token_t.symbol holds for a token that has none
+#define LOX_NO_SYMBOL UINT32_MAX
+
+// a token is a span of the source that was lexed. nothing is copied but the
+// literals of strings with escapes (or every distinct name and literal, with
+// interning on)
+struct lox_token_t {
+  enum lox_token_type_t type;
+  uint64_t offset;
+  uint64_t length;
+  // LOX_TOKEN_NUMBER only, 0 otherwise
+  double number;
+  // LOX_TOKEN_STRING only, NULL otherwise: the literal with its escapes
+  // (\n, \t, \", \\ and \u{...}) decoded, not NUL-terminated. without
+  // escapes it's the span minus its quotes, inside the source; with them it's
+  // the lexer's and only good until the token sink returns. with interning
+  // on it's always the lexer's, and good as long as the symbol
+  const char *literal;
+  size_t literal_length;
+  // LOX_TOKEN_IDENTIFIER and LOX_TOKEN_STRING with interning on, see
+  // lox_lexer_set_interning. LOX_NO_SYMBOL otherwise
+  uint32_t symbol;
+};
+
+enum lox_status_t {
+  LOX_OK,
+  // every token was delivered, but some bytes weren't valid lox
+  LOX_LEXICAL_ERROR,
+  // the token sink asked to stop
+  LOX_STOPPED,
+  // the lexer went over its memory limit (or the system ran out). the
+  // tokens delivered so far are all there is
+  LOX_OUT_OF_MEMORY,
+};
+
+// tokens arrive in order, up to LOX_TOKEN_BATCH per call, the last batch
+// ending with LOX_TOKEN_EOF. the array is only good for the duration of the
+// call. return nonzero to stop lexing
+typedef int (*lox_token_sink_t)(void *context, const struct lox_token_t *tokens,
+                                size_t count);
+
+#define LOX_TOKEN_BATCH 256
+
+// one diagnostic. the message is exactly what `interpreter tokenize` would
+// print (e.g. "[line 3] Error: Unterminated string.") but without the newline,
+// and only good for the duration of the call
+struct lox_diagnostic_t {
+  const char *message;
+  size_t length;
+  // where the offending token starts: the opening quote of a bad string, the
+  // unexpected character itself. the column counts code points, from 1. all
+  // 0 for the note that the rest were left out
+  uint64_t offset;
+  uint64_t line;
+  uint64_t column;
+};
+
+// delivered as soon as it's found, so ahead of the batch holding the tokens
+// after it
+typedef void (*lox_diagnostic_sink_t)(
+    void *context, const struct lox_diagnostic_t *diagnostic);
+
+struct lox_lexer_t;
+
+// returns NULL when out of memory
+struct lox_lexer_t *lox_lexer_create(void);
+
+// without a diagnostic sink (the default) diagnostics are dropped; the status
+// still says whether there were any
+void lox_lexer_set_diagnostic_sink(struct lox_lexer_t *lexer,
+                                   lox_diagnostic_sink_t sink, void *context);
+
+// most diagnostics delivered per lox_lex call, 0 (the default) for all of
+// them. past it, a single note says the rest were left out
+void lox_lexer_set_max_errors(struct lox_lexer_t *lexer, uint64_t max_errors);
+
+// with interning on, identifiers and string literals get symbols: equal names
+// (or literals, escapes decoded) get the same one, numbered 0, 1, 2, ... in
+// order of first appearance. names and literals share the numbering. symbols
+// hold across lox_lex calls until interning is turned off or the lexer is
+// reset. off by default. returns 0 when out of memory
+int lox_lexer_set_interning(struct lox_lexer_t *lexer, int enabled);
+
+// lexes source[0, length), which needs no terminator and may contain NUL
+// bytes. tokens aren't accumulated, they're handed out as they're scanned
+enum lox_status_t lox_lex(struct lox_lexer_t *lexer, const char *source,
+                          size_t length, lox_token_sink_t sink,
+                          void *context);
+
+// most bytes the lexer may hold at once, 0 (the default) for no limit. it
+// holds little besides the current batch, except that the first diagnostic
+// has it index the lines of the whole source (8 bytes a line). an index
+// that doesn't fit is skipped, lines are then counted as needed instead
+void lox_lexer_set_max_memory(struct lox_lexer_t *lexer, uint64_t max_memory);
+
+// gives back the memory a large input made the lexer hold on to. the sinks
+// and settings stay, but symbols start over
+void lox_lexer_reset(struct lox_lexer_t *lexer);
+
+void lox_lexer_destroy(struct lox_lexer_t *lexer);
+
+// "LEFT_PAREN", "EOF", ..., as `interpreter tokenize` prints them
+const char *lox_token_type_name(enum lox_token_type_t type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOX_H
@@ -0,0 +1,104 @@
+#include "alloc.h"
+
+// takes size more bytes out of the budget, returns 0 if that goes over
+static int counting_charge(struct counting_allocator_t *counter,
+                           uint64_t size) {
+  uint64_t live =
+      __atomic_add_fetch(&counter->live, size, __ATOMIC_RELAXED);
+
+  if (counter->limit != 0 && live > counter->limit) {
+    __atomic_sub_fetch(&counter->live, size, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&counter->refused, 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+
+  uint64_t peak = __atomic_load_n(&counter->peak, __ATOMIC_RELAXED);
+
+  while (live > peak &&
+         !__atomic_compare_exchange_n(&counter->peak, &peak, live, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+
+  return 1;
+}
+
+static void counting_credit(struct counting_allocator_t *counter,
+                            uint64_t size) {
+  __atomic_sub_fetch(&counter->live, size, __ATOMIC_RELAXED);
+}
+
+static void counting_record(struct counting_allocator_t *counter,
+                            uint64_t size) {
+  __atomic_add_fetch(&counter->total, size, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&counter->allocations, 1, __ATOMIC_RELAXED);
+}
+
+static void *counting_allocate(void *context, uint64_t size) {
+  struct counting_allocator_t *counter =
+      (struct counting_allocator_t *)context;
+
+  if (!counting_charge(counter, size))
+    return NULL;
+
+  void *pointer = alloc_allocate(counter->parent, size);
+
+  if (pointer == NULL) {
+    counting_credit(counter, size);
+    return NULL;
+  }
+
+  counting_record(counter, size);
+
+  return pointer;
+}
+
+static void *counting_reallocate(void *context, void *pointer,
+                                 uint64_t old_size, uint64_t new_size) {
+  struct counting_allocator_t *counter =
+      (struct counting_allocator_t *)context;
+
+  // only growth is charged up front, a shrink can't go over the limit
+  if (new_size > old_size && !counting_charge(counter, new_size - old_size))
+    return NULL;
+
+  void *resized =
+      alloc_reallocate(counter->parent, pointer, old_size, new_size);
+
+  if (resized == NULL) {
+    if (new_size > old_size)
+      counting_credit(counter, new_size - old_size);
+
+    return NULL;
+  }
+
+  if (new_size < old_size)
+    counting_credit(counter, old_size - new_size);
+
+  counting_record(counter, new_size);
+
+  return resized;
+}
+
+static void counting_release(void *context, void *pointer, uint64_t size) {
+  struct counting_allocator_t *counter =
+      (struct counting_allocator_t *)context;
+
+  alloc_release(counter->parent, pointer, size);
+  counting_credit(counter, size);
+}
+
+void counting_allocator_init(struct counting_allocator_t *counter,
+                             const struct allocator_t *parent,
+                             uint64_t limit) {
+  *counter = (struct counting_allocator_t){
+      .allocator =
+          {
+              .allocate = counting_allocate,
+              .reallocate = counting_reallocate,
+              .release = counting_release,
+              .context = counter,
+          },
+      .parent = parent,
+      .limit = limit,
+  };
+}
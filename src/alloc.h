@@ -0,0 +1,95 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// where a component gets its memory from. everything that allocates on the
+// scanner's behalf (parser, token stream, arena, line index, tables, vectors)
+// takes one at create time and goes through it from then on, so a caller can
+// count or cap what a single parse holds. NULL means plain malloc/free
+//
+// every call carries the size of the block, so an allocator can keep exact
+// counts without a header in front of each block
+
+struct allocator_t {
+  // returns NULL on failure
+  void *(*allocate)(void *context, uint64_t size);
+  // pointer may be NULL (old_size 0). on failure returns NULL and leaves the
+  // block as it was
+  void *(*reallocate)(void *context, void *pointer, uint64_t old_size,
+                      uint64_t new_size);
+  // size is what the block was last allocated or resized with
+  void (*release)(void *context, void *pointer, uint64_t size);
+  void *context;
+};
+
+static inline void *alloc_allocate(const struct allocator_t *allocator,
+                                   uint64_t size) {
+  if (allocator == NULL)
+    return malloc(size);
+
+  return allocator->allocate(allocator->context, size);
+}
+
+static inline void *alloc_zeroed(const struct allocator_t *allocator,
+                                 uint64_t size) {
+  if (allocator == NULL)
+    return calloc(1, size);
+
+  void *pointer = allocator->allocate(allocator->context, size);
+
+  if (pointer != NULL)
+    memset(pointer, 0, size);
+
+  return pointer;
+}
+
+static inline void *alloc_reallocate(const struct allocator_t *allocator,
+                                     void *pointer, uint64_t old_size,
+                                     uint64_t new_size) {
+  if (allocator == NULL)
+    return realloc(pointer, new_size);
+
+  return allocator->reallocate(allocator->context, pointer, old_size,
+                               new_size);
+}
+
+// pointer may be NULL
+static inline void alloc_release(const struct allocator_t *allocator,
+                                 void *pointer, uint64_t size) {
+  if (allocator == NULL)
+    free(pointer);
+  else if (pointer != NULL)
+    allocator->release(allocator->context, pointer, size);
+}
+
+// passes everything on to a parent allocator, keeping count on the way. with
+// a limit it's a hard cap: a request that would take the live total past it
+// fails (as if the system were out of memory) instead of being forwarded, so
+// a parse over budget stops cleanly rather than taking the host down. the
+// counters are atomic, so parsers on different threads can share a budget
+struct counting_allocator_t {
+  // what components are given, &counter->allocator
+  struct allocator_t allocator;
+  // NULL for malloc/free
+  const struct allocator_t *parent;
+  // most bytes live at once, 0 for no limit
+  uint64_t limit;
+  // bytes held right now, and the most ever held at once
+  uint64_t live;
+  uint64_t peak;
+  // bytes and blocks handed out over the lifetime (growing a block counts
+  // as handing out its new size)
+  uint64_t total;
+  uint64_t allocations;
+  // requests turned down because of the limit
+  uint64_t refused;
+};
+
+void counting_allocator_init(struct counting_allocator_t *counter,
+                             const struct allocator_t *parent,
+                             uint64_t limit);
+
+#endif // ALLOC_H
@@ -0,0 +1,201 @@
+#include "arena.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGNMENT _Alignof(max_align_t)
+
+static size_t align_up(size_t size) {
+  return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+static struct arena_block_t *arena_block_create(struct arena_t *arena,
+                                                size_t capacity) {
+  struct arena_block_t *block = (struct arena_block_t *)alloc_allocate(
+      arena->allocator, sizeof(struct arena_block_t) + capacity);
+
+  if (block == NULL) {
+    LOG_ERROR("arena_block_create: error allocating block of %zu bytes",
+              capacity);
+    return NULL;
+  }
+
+  block->next = NULL;
+  block->capacity = capacity;
+  block->used = 0;
+
+  return block;
+}
+
+static void arena_block_destroy(struct arena_t *arena,
+                                struct arena_block_t *block) {
+  alloc_release(arena->allocator, block,
+                sizeof(struct arena_block_t) + block->capacity);
+}
+
+struct arena_t *arena_create(size_t block_size,
+                             const struct allocator_t *allocator) {
+  if (block_size == 0) {
+    LOG_ERROR("arena_create: cannot have block size 0, must be > 0");
+    return NULL;
+  }
+
+  struct arena_t *arena =
+      (struct arena_t *)alloc_zeroed(allocator, sizeof(struct arena_t));
+
+  if (arena == NULL) {
+    LOG_ERROR("arena_create: error allocating memory for arena");
+    return NULL;
+  }
+
+  arena->allocator = allocator;
+  arena->block_size = align_up(block_size);
+  arena->head = arena_block_create(arena, arena->block_size);
+
+  if (arena->head == NULL) {
+    alloc_release(allocator, arena, sizeof(struct arena_t));
+    return NULL;
+  }
+
+  return arena;
+}
+
+void *arena_alloc(struct arena_t *arena, size_t size) {
+  if (arena == NULL) {
+    LOG_ERROR("arena_alloc: null arena provided");
+    return NULL;
+  }
+
+  size = align_up(size);
+
+  struct arena_block_t *block = arena->head;
+
+  // fast path: bump inside the current block
+  if (block != NULL && block->capacity - block->used >= size) {
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+  }
+
+  // oversized requests get a dedicated block so we don't waste the rest of a
+  // regular one; it's linked behind the head so bumping continues there
+  if (size > arena->block_size / 2) {
+    struct arena_block_t *large = arena_block_create(arena, size);
+
+    if (large == NULL)
+      return NULL;
+
+    large->used = size;
+
+    // after a reset that kept no block there's no head to hide behind, the
+    // next small request starts a regular one in front
+    if (block == NULL) {
+      arena->head = large;
+    } else {
+      large->next = block->next;
+      block->next = large;
+    }
+
+    return large->data;
+  }
+
+  struct arena_block_t *fresh = arena_block_create(arena, arena->block_size);
+
+  if (fresh == NULL)
+    return NULL;
+
+  fresh->next = block;
+  fresh->used = size;
+  arena->head = fresh;
+
+  return fresh->data;
+}
+
+char *arena_strndup(struct arena_t *arena, const char *src, size_t length) {
+  char *copy = (char *)arena_alloc(arena, length + 1);
+
+  if (copy == NULL)
+    return NULL;
+
+  memcpy(copy, src, length);
+  copy[length] = '\0';
+
+  return copy;
+}
+
+void arena_adopt(struct arena_t *arena, struct arena_t *other) {
+  if (arena == NULL || other == NULL) {
+    LOG_ERROR("arena_adopt: null arena provided");
+    return;
+  }
+
+  struct arena_block_t *first = other->head;
+
+  if (first == NULL)
+    return;
+
+  struct arena_block_t *last = first;
+
+  while (last->next != NULL)
+    last = last->next;
+
+  // behind the head, which keeps bumping where it was
+  if (arena->head != NULL) {
+    last->next = arena->head->next;
+    arena->head->next = first;
+  } else {
+    arena->head = first;
+  }
+
+  other->head = NULL;
+}
+
+void arena_reset(struct arena_t *arena) {
+  if (arena == NULL) {
+    LOG_ERROR("arena_reset: null arena provided");
+    return;
+  }
+
+  // keep a single regular block around so a reused arena doesn't go back to
+  // malloc for small inputs
+  struct arena_block_t *keep = NULL;
+  struct arena_block_t *block = arena->head;
+
+  while (block != NULL) {
+    struct arena_block_t *next = block->next;
+
+    if (keep == NULL && block->capacity == arena->block_size) {
+      keep = block;
+    } else {
+      arena_block_destroy(arena, block);
+    }
+
+    block = next;
+  }
+
+  if (keep != NULL) {
+    keep->next = NULL;
+    keep->used = 0;
+  }
+
+  // a NULL head is fine, the next arena_alloc starts a fresh block
+  arena->head = keep;
+}
+
+void arena_destroy(struct arena_t *arena) {
+  if (arena == NULL) {
+    LOG_ERROR("arena_destroy: null arena provided");
+    return;
+  }
+
+  struct arena_block_t *block = arena->head;
+
+  while (block != NULL) {
+    struct arena_block_t *next = block->next;
+    arena_block_destroy(arena, block);
+    block = next;
+  }
+
+  alloc_release(arena->allocator, arena, sizeof(struct arena_t));
+}
@@ -0,0 +1,41 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "alloc.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// bump allocator: everything handed out lives until arena_reset/destroy, so
+// callers never free individual allocations
+struct arena_block_t {
+  struct arena_block_t *next;
+  size_t capacity;
+  size_t used;
+  // block memory follows the header
+  _Alignas(max_align_t) unsigned char data[];
+};
+
+struct arena_t {
+  struct arena_block_t *head;
+  size_t block_size;
+  // where blocks come from, NULL for malloc
+  const struct allocator_t *allocator;
+};
+
+struct arena_t *arena_create(size_t block_size,
+                             const struct allocator_t *allocator);
+
+void *arena_alloc(struct arena_t *arena, size_t size);
+
+char *arena_strndup(struct arena_t *arena, const char *src, size_t length);
+
+// moves every block of other into arena, so what was allocated from other
+// lives as long as arena does. both must use the same allocator; other is
+// left empty
+void arena_adopt(struct arena_t *arena, struct arena_t *other);
+
+void arena_reset(struct arena_t *arena);
+
+void arena_destroy(struct arena_t *arena);
+
+#endif // ARENA_H
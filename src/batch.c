@@ -0,0 +1,356 @@
+#include "batch.h"
+#include "alloc.h"
+#include "parallel_parser.h"
+#include "pool.h"
+#include "source.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+
+// starting size of a file's output buffer, grows from there
+#define BATCH_FILE_BUFFER_SIZE (16 * 1024)
+
+#define BATCH_EXTENSION ".lox"
+
+struct batch_file_t {
+  const char *path;
+  struct output_t *out;
+  struct diagnostics_t *errors;
+  int exit_code;
+  uint8_t done;
+};
+
+struct batch_t {
+  struct batch_file_t *files;
+  const struct tokenize_options_t *options;
+  // one per worker, reused for every file the worker takes
+  struct parser_t **parsers;
+  // what each worker's parser allocates from, capped at --max-memory
+  struct counting_allocator_t *budgets;
+  // also per worker, merged once the pool is done. NULL with stats off
+  struct stats_t *stats;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+};
+
+static int batch_is_directory(const char *path) {
+  struct stat info;
+
+  return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+int batch_wanted(const struct tokenize_options_t *options) {
+  return options->input_count > 1 || options->inputs[0][0] == '@' ||
+         batch_is_directory(options->inputs[0]);
+}
+
+static int batch_add_file(struct path_list_t *files, const char *path,
+                          size_t length) {
+  char *copy = strndup(path, length);
+
+  if (copy == NULL) {
+    LOG_ERROR("batch_add_file: error allocating memory for path");
+    return 0;
+  }
+
+  if (!path_list_push(files, copy)) {
+    free(copy);
+    return 0;
+  }
+
+  return 1;
+}
+
+static int batch_has_extension(const char *name) {
+  size_t length = strlen(name);
+  size_t extension = sizeof(BATCH_EXTENSION) - 1;
+
+  return length > extension &&
+         strcmp(name + length - extension, BATCH_EXTENSION) == 0;
+}
+
+static int batch_compare_names(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int batch_add_directory(struct path_list_t *files, const char *path) {
+  DIR *directory = opendir(path);
+
+  if (directory == NULL) {
+    fprintf(stderr, "Error reading directory: %s\n", path);
+    return 0;
+  }
+
+  // readdir order is arbitrary, sort so runs are reproducible
+  struct path_list_t names = {0};
+  struct dirent *entry;
+  int ok = 1;
+
+  while (ok && (entry = readdir(directory)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+
+    ok = batch_add_file(&names, entry->d_name, strlen(entry->d_name));
+  }
+
+  closedir(directory);
+
+  if (names.size > 0)
+    qsort(names.data, names.size, sizeof(char *), batch_compare_names);
+
+  size_t path_length = strlen(path);
+
+  for (uint64_t i = 0; i < names.size; i++) {
+    const char *name = names.data[i];
+    size_t size = path_length + strlen(name) + 2;
+    char *child = (char *)malloc(size);
+
+    if (child == NULL) {
+      LOG_ERROR("batch_add_directory: error allocating memory for path");
+      ok = 0;
+      break;
+    }
+
+    snprintf(child, size, "%s/%s", path, name);
+
+    // symlinked directories aren't followed, they could loop back up
+    struct stat info;
+
+    if (lstat(child, &info) == 0) {
+      if (S_ISDIR(info.st_mode))
+        ok &= batch_add_directory(files, child);
+      else if (batch_has_extension(name))
+        ok &= batch_add_file(files, child, strlen(child));
+    }
+
+    free(child);
+  }
+
+  batch_release(&names);
+
+  return ok;
+}
+
+static int batch_add_input(struct path_list_t *files, const char *path,
+                           size_t length) {
+  char *copy = strndup(path, length);
+
+  if (copy == NULL) {
+    LOG_ERROR("batch_add_input: error allocating memory for path");
+    return 0;
+  }
+
+  int ok = batch_is_directory(copy) ? batch_add_directory(files, copy)
+                                    : batch_add_file(files, copy, length);
+  free(copy);
+
+  return ok;
+}
+
+// every non-empty line names a file or a directory
+static int batch_add_listfile(struct path_list_t *files, const char *path) {
+  struct source_t *list = source_open(path);
+
+  if (list == NULL) {
+    fprintf(stderr, "Error reading file: %s\n", path);
+    return 0;
+  }
+
+  int ok = 1;
+  uint64_t start = 0;
+
+  while (start < list->length) {
+    const char *line = list->data + start;
+    const char *newline = memchr(line, '\n', list->length - start);
+    uint64_t length =
+        newline != NULL ? (uint64_t)(newline - line) : list->length - start;
+
+    start += length + 1;
+
+    if (length > 0 && line[length - 1] == '\r')
+      length--;
+
+    if (length > 0)
+      ok &= batch_add_input(files, line, length);
+  }
+
+  source_close(list);
+
+  return ok;
+}
+
+int batch_collect(const struct tokenize_options_t *options,
+                  struct path_list_t *files) {
+  int ok = 1;
+
+  for (uint32_t i = 0; i < options->input_count; i++) {
+    const char *input = options->inputs[i];
+
+    if (input[0] == '@')
+      ok &= batch_add_listfile(files, input + 1);
+    else
+      ok &= batch_add_input(files, input, strlen(input));
+  }
+
+  return ok;
+}
+
+static void batch_tokenize_file(void *context, uint32_t worker,
+                                uint64_t index) {
+  struct batch_t *batch = (struct batch_t *)context;
+  struct batch_file_t *file = &batch->files[index];
+  struct parser_t *parser = batch->parsers[worker];
+  struct stats_t *stats =
+      batch->stats != NULL ? &batch->stats[worker] : NULL;
+
+  file->out = output_create_memory(BATCH_FILE_BUFFER_SIZE);
+  file->errors = diagnostics_create();
+  file->exit_code = 1;
+
+  if (file->errors != NULL)
+    file->errors->limit = batch->options->max_errors;
+
+  if (parser != NULL && file->out != NULL && file->errors != NULL) {
+    parser_reset(parser);
+    file->exit_code = tokenize_file(parser, file->out, file->errors,
+                                    file->path, batch->options, stats);
+  }
+
+  pthread_mutex_lock(&batch->lock);
+  file->done = 1;
+  pthread_cond_broadcast(&batch->ready);
+  pthread_mutex_unlock(&batch->lock);
+}
+
+int batch_tokenize(const struct path_list_t *files, struct output_t *out,
+                   const struct tokenize_options_t *options,
+                   struct stats_t *stats) {
+  uint64_t count = files->size;
+  uint32_t workers =
+      options->threads_given && options->threads != 0
+          ? options->threads
+          : parallel_parser_default_threads();
+
+  if (workers > count)
+    workers = count > 0 ? (uint32_t)count : 1;
+
+  // every file is scanned on a single thread, the pool is the parallelism
+  struct tokenize_options_t file_options = *options;
+  file_options.threads = 1;
+
+  struct batch_t batch = {
+      .files = (struct batch_file_t *)calloc(count + 1,
+                                             sizeof(struct batch_file_t)),
+      .options = &file_options,
+      .parsers = (struct parser_t **)calloc(workers, sizeof(void *)),
+      .budgets = (struct counting_allocator_t *)calloc(
+          workers, sizeof(struct counting_allocator_t)),
+  };
+
+  if (stats != NULL)
+    batch.stats = (struct stats_t *)calloc(workers, sizeof(struct stats_t));
+
+  if (batch.files == NULL || batch.parsers == NULL || batch.budgets == NULL ||
+      (stats != NULL && batch.stats == NULL)) {
+    LOG_ERROR("batch_tokenize: error allocating memory for batch");
+    free(batch.files);
+    free(batch.parsers);
+    free(batch.budgets);
+    free(batch.stats);
+    return 1;
+  }
+
+  pthread_mutex_init(&batch.lock, NULL);
+  pthread_cond_init(&batch.ready, NULL);
+
+  for (uint64_t i = 0; i < count; i++)
+    batch.files[i].path = files->data[i];
+
+  // the cap is per worker, so it bounds each file on its own (plus whatever
+  // the worker's parser kept from the files before)
+  for (uint32_t i = 0; i < workers; i++) {
+    counting_allocator_init(&batch.budgets[i], NULL, options->max_memory);
+    batch.parsers[i] = parser_create(&batch.budgets[i].allocator);
+  }
+
+  struct pool_t *pool =
+      pool_create(workers, count, batch_tokenize_file, &batch);
+
+  // without a pool, just work through the list here
+  if (pool == NULL) {
+    for (uint64_t i = 0; i < count; i++)
+      batch_tokenize_file(&batch, 0, i);
+  }
+
+  int exit_code = 0;
+
+  // results come in roughly in order, hand each one out as soon as every file
+  // before it has been
+  for (uint64_t i = 0; i < count; i++) {
+    struct batch_file_t *file = &batch.files[i];
+
+    pthread_mutex_lock(&batch.lock);
+
+    while (!file->done)
+      pthread_cond_wait(&batch.ready, &batch.lock);
+
+    pthread_mutex_unlock(&batch.lock);
+
+    // read errors included, so they come out in file order too
+    if (file->errors != NULL) {
+      if (file->errors->length != 0)
+        fwrite(file->errors->text, 1, file->errors->length, stderr);
+
+      diagnostics_destroy(file->errors);
+    }
+
+    if (file->out != NULL) {
+      // a buffer that couldn't grow lost part of the output
+      if (file->out->error)
+        file->exit_code = 1;
+
+      output_write(out, file->out->buffer, file->out->length);
+      output_destroy(file->out);
+    }
+
+    // a file that couldn't be read outranks lexical errors elsewhere
+    if (file->exit_code == 1)
+      exit_code = 1;
+    else if (file->exit_code == 65 && exit_code == 0)
+      exit_code = 65;
+  }
+
+  if (pool != NULL)
+    pool_destroy(pool);
+
+  for (uint32_t i = 0; i < workers; i++) {
+    if (batch.parsers[i] != NULL)
+      parser_destroy(batch.parsers[i]);
+
+    if (stats != NULL) {
+      batch.stats[i].scanner_peak_bytes = batch.budgets[i].peak;
+      stats_merge(stats, &batch.stats[i]);
+    }
+  }
+
+  pthread_cond_destroy(&batch.ready);
+  pthread_mutex_destroy(&batch.lock);
+  free(batch.parsers);
+  free(batch.budgets);
+  free(batch.stats);
+  free(batch.files);
+
+  return exit_code;
+}
+
+void batch_release(struct path_list_t *files) {
+  for (uint64_t i = 0; i < files->size; i++)
+    free(files->data[i]);
+
+  path_list_release(files);
+}
@@ -0,0 +1,34 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "output.h"
+#include "tokenize.h"
+#include "vec.h"
+#include <stdint.h>
+
+// heap-allocated paths, freed by batch_release
+VEC_DEFINE(path_list, char *)
+
+// whether the inputs call for batch mode: more than one of them, an
+// @listfile or a directory
+int batch_wanted(const struct tokenize_options_t *options);
+
+// expands the inputs into the list of files to tokenize, in order. directories
+// contribute their *.lox files (recursively, sorted by name) and @listfiles
+// one entry per line. returns 0 if some input couldn't be read, the list still
+// has everything that could
+int batch_collect(const struct tokenize_options_t *options,
+                  struct path_list_t *files);
+
+// tokenizes every file on a pool of workers, one parser each. each file's
+// output and diagnostics are buffered and written to out and stderr in list
+// order. returns 1 if any file couldn't be read, else 65 if any had lexical
+// errors, else 0. stats, when not NULL, gets the sum over every file
+int batch_tokenize(const struct path_list_t *files, struct output_t *out,
+                   const struct tokenize_options_t *options,
+                   struct stats_t *stats);
+
+// frees the paths batch_collect added and the list's storage
+void batch_release(struct path_list_t *files);
+
+#endif // BATCH_H
@@ -0,0 +1,121 @@
+#include "chunk_reader.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+
+struct chunk_reader_t *
+chunk_reader_create(int fd, uint64_t chunk_size,
+                    const struct allocator_t *allocator) {
+  if (chunk_size == 0) {
+    LOG_ERROR("chunk_reader_create: cannot have chunk size 0, must be > 0");
+    return NULL;
+  }
+
+  struct chunk_reader_t *reader = (struct chunk_reader_t *)alloc_zeroed(
+      allocator, sizeof(struct chunk_reader_t));
+
+  if (reader == NULL) {
+    LOG_ERROR("chunk_reader_create: error allocating memory for reader");
+    return NULL;
+  }
+
+  reader->allocator = allocator;
+  reader->buffer = (char *)alloc_allocate(allocator, chunk_size);
+
+  if (reader->buffer == NULL) {
+    LOG_ERROR("chunk_reader_create: error allocating chunk buffer");
+    alloc_release(allocator, reader, sizeof(struct chunk_reader_t));
+    return NULL;
+  }
+
+  reader->fd = fd;
+  reader->capacity = chunk_size;
+
+  return reader;
+}
+
+// a single read into the free tail of the buffer. returns 0 on error
+static int chunk_reader_read(struct chunk_reader_t *reader) {
+  for (;;) {
+    ssize_t bytes_read = read(reader->fd, reader->buffer + reader->length,
+                              reader->capacity - reader->length);
+
+    if (bytes_read < 0) {
+      if (errno == EINTR)
+        continue;
+
+      LOG_ERROR("Error reading file contents");
+      return 0;
+    }
+
+    if (bytes_read == 0)
+      reader->eof = 1;
+
+    reader->length += (uint64_t)bytes_read;
+    return 1;
+  }
+}
+
+int chunk_reader_next(struct chunk_reader_t *reader, struct parser_t *parser) {
+  if (reader->done)
+    return 0;
+
+  // hand back the bytes of any incomplete token to the front of the buffer
+  uint64_t carried = reader->length - reader->consumed;
+  memmove(reader->buffer, reader->buffer + reader->consumed, carried);
+  reader->length = carried;
+  reader->consumed = 0;
+
+  // a token bigger than the whole buffer, make room for it
+  if (reader->length == reader->capacity) {
+    char *grown = (char *)alloc_reallocate(reader->allocator, reader->buffer,
+                                           reader->capacity,
+                                           reader->capacity * 2);
+
+    if (grown == NULL) {
+      LOG_ERROR("chunk_reader_next: error growing chunk buffer");
+      parser->out_of_memory = 1;
+      parser->error = 1;
+      return -1;
+    }
+
+    reader->buffer = grown;
+    reader->capacity *= 2;
+  }
+
+  if (!chunk_reader_read(reader))
+    return -1;
+
+  // when only a partial token is carried over, wait for a full buffer before
+  // rescanning it; otherwise a long string would be rescanned on every read
+  while (carried > 0 && !reader->eof && reader->length < reader->capacity) {
+    if (!chunk_reader_read(reader))
+      return -1;
+  }
+
+  // the previous chunk's tokens have gone out, and with them any literal
+  // decoded into the arena
+  token_stream_clear(parser->tokens);
+  arena_reset(parser->arena);
+
+  reader->consumed =
+      parser_feed(parser, reader->buffer, reader->length, reader->eof);
+
+  reader->done = reader->eof;
+
+  return 1;
+}
+
+void chunk_reader_destroy(struct chunk_reader_t *reader) {
+  if (reader == NULL) {
+    LOG_ERROR("chunk_reader_destroy: null reader provided");
+    return;
+  }
+
+  alloc_release(reader->allocator, reader->buffer, reader->capacity);
+  alloc_release(reader->allocator, reader, sizeof(struct chunk_reader_t));
+}
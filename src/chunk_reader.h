@@ -0,0 +1,35 @@
+#ifndef CHUNK_READER_H
+#define CHUNK_READER_H
+
+#include "parser.h"
+#include <stdint.h>
+
+// drives parser_feed over a file descriptor one chunk at a time, so memory
+// stays bounded by the chunk size (plus the longest single token) no matter
+// how large the input is
+struct chunk_reader_t {
+  int fd;
+  char *buffer;
+  uint64_t length;
+  uint64_t capacity;
+  // bytes at the front of buffer already turned into tokens
+  uint64_t consumed;
+  uint8_t eof;
+  uint8_t done;
+  // where the reader and its buffer come from, NULL for malloc
+  const struct allocator_t *allocator;
+};
+
+struct chunk_reader_t *chunk_reader_create(int fd, uint64_t chunk_size,
+                                           const struct allocator_t *allocator);
+
+// scans the next chunk into the parser's token stream (clearing what the
+// previous call produced). token offsets are relative to reader->buffer and
+// only valid until the next call. returns 1 when tokens were produced, 0 once
+// the input is exhausted and -1 on a read error. running out of memory for a
+// long token is -1 as well, with parser->out_of_memory set
+int chunk_reader_next(struct chunk_reader_t *reader, struct parser_t *parser);
+
+void chunk_reader_destroy(struct chunk_reader_t *reader);
+
+#endif // CHUNK_READER_H
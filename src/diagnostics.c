@@ -0,0 +1,166 @@
+#include "diagnostics.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIAGNOSTICS_INITIAL_CAPACITY 256
+
+struct diagnostics_t *diagnostics_create() {
+  struct diagnostics_t *diagnostics =
+      (struct diagnostics_t *)calloc(1, sizeof(struct diagnostics_t));
+
+  if (diagnostics == NULL) {
+    LOG_ERROR("diagnostics_create: error allocating memory for diagnostics");
+    return NULL;
+  }
+
+  return diagnostics;
+}
+
+// makes room for length more bytes plus vsnprintf's terminator
+static int diagnostics_reserve(struct diagnostics_t *diagnostics,
+                               uint64_t length) {
+  uint64_t required = diagnostics->length + length + 1;
+
+  if (required <= diagnostics->capacity)
+    return 1;
+
+  uint64_t capacity = diagnostics->capacity == 0 ? DIAGNOSTICS_INITIAL_CAPACITY
+                                                 : diagnostics->capacity;
+
+  while (capacity < required)
+    capacity *= 2;
+
+  char *grown = (char *)realloc(diagnostics->text, capacity);
+
+  if (grown == NULL) {
+    LOG_ERROR("diagnostics_reserve: error growing diagnostics buffer");
+    return 0;
+  }
+
+  diagnostics->text = grown;
+  diagnostics->capacity = capacity;
+
+  return 1;
+}
+
+// counts a diagnostic past the limit, the first one leaves the note behind.
+// returns 0 if the diagnostic has to go
+static int diagnostics_over_limit(struct diagnostics_t *diagnostics) {
+  if (diagnostics->limit == 0 || diagnostics->count < diagnostics->limit)
+    return 0;
+
+  if (diagnostics->dropped++ == 0 &&
+      diagnostics_reserve(diagnostics, sizeof(DIAGNOSTICS_LIMIT_NOTE) - 1)) {
+    memcpy(diagnostics->text + diagnostics->length, DIAGNOSTICS_LIMIT_NOTE,
+           sizeof(DIAGNOSTICS_LIMIT_NOTE) - 1);
+    diagnostics->length += sizeof(DIAGNOSTICS_LIMIT_NOTE) - 1;
+  }
+
+  return 1;
+}
+
+int diagnostics_vadd(struct diagnostics_t *diagnostics, const char *format,
+                     va_list args) {
+  if (diagnostics_over_limit(diagnostics))
+    return 0;
+
+  // format straight into the free space, only a message that doesn't fit
+  // needs a second pass
+  uint64_t space = diagnostics->capacity - diagnostics->length;
+  va_list attempt;
+  va_copy(attempt, args);
+  int length = vsnprintf(space > 0 ? diagnostics->text + diagnostics->length
+                                   : NULL,
+                         space, format, attempt);
+  va_end(attempt);
+
+  if (length < 0)
+    return 0;
+
+  if ((uint64_t)length >= space) {
+    if (!diagnostics_reserve(diagnostics, (uint64_t)length))
+      return 0;
+
+    vsnprintf(diagnostics->text + diagnostics->length, (size_t)length + 1,
+              format, args);
+  }
+
+  diagnostics->length += (uint64_t)length;
+  diagnostics->count++;
+
+  return 1;
+}
+
+int diagnostics_add(struct diagnostics_t *diagnostics, const char *format,
+                    ...) {
+  va_list args;
+  va_start(args, format);
+  int added = diagnostics_vadd(diagnostics, format, args);
+  va_end(args);
+
+  return added;
+}
+
+int diagnostics_append(struct diagnostics_t *diagnostics,
+                       const struct diagnostics_t *source) {
+  if (source->length == 0)
+    return 1;
+
+  uint64_t count = source->count;
+  uint64_t length = source->length;
+
+  // past the limit, keep the lines that still fit
+  if (diagnostics->limit != 0 &&
+      diagnostics->count + count > diagnostics->limit) {
+    count = diagnostics->limit > diagnostics->count
+                ? diagnostics->limit - diagnostics->count
+                : 0;
+    length = 0;
+
+    for (uint64_t kept = 0; kept < count; kept++) {
+      const char *end = (const char *)memchr(source->text + length, '\n',
+                                             source->length - length);
+      length = end != NULL ? (uint64_t)(end - source->text) + 1
+                           : source->length;
+    }
+  }
+
+  if (!diagnostics_reserve(diagnostics, length))
+    return 0;
+
+  memcpy(diagnostics->text + diagnostics->length, source->text, length);
+
+  diagnostics->length += length;
+  diagnostics->count += count;
+
+  for (uint64_t i = count; i < source->count; i++)
+    diagnostics_over_limit(diagnostics);
+
+  return 1;
+}
+
+void diagnostics_flush(struct diagnostics_t *diagnostics, FILE *file) {
+  // nothing may have been added yet, and fwrite won't take a NULL buffer
+  if (diagnostics->length != 0)
+    fwrite(diagnostics->text, 1, diagnostics->length, file);
+
+  diagnostics->length = 0;
+}
+
+void diagnostics_clear(struct diagnostics_t *diagnostics) {
+  diagnostics->length = 0;
+  diagnostics->count = 0;
+  diagnostics->dropped = 0;
+}
+
+void diagnostics_destroy(struct diagnostics_t *diagnostics) {
+  if (diagnostics == NULL) {
+    LOG_ERROR("diagnostics_destroy: null diagnostics provided");
+    return;
+  }
+
+  free(diagnostics->text);
+  free(diagnostics);
+}
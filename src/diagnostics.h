@@ -0,0 +1,52 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// diagnostics collected instead of printed. each one is kept as the exact text
+// it would have been printed as, so it can be written out (or stored and
+// replayed) later on
+
+// what takes the place of the diagnostics past the limit
+#define DIAGNOSTICS_LIMIT_NOTE "Too many errors, the rest are not shown.\n"
+
+struct diagnostics_t {
+  // plain malloc, not a scanner's allocator: like an output buffer, it's the
+  // caller's and often outlives the parse it was filled by
+  char *text;
+  uint64_t length;
+  uint64_t capacity;
+  uint64_t count;
+  // most diagnostics to keep, 0 for no limit. past it they're only counted in
+  // dropped, and a single note saying so takes their place
+  uint64_t limit;
+  uint64_t dropped;
+};
+
+struct diagnostics_t *diagnostics_create();
+
+// appends one printf-style formatted diagnostic, returns 0 if it was dropped
+// because no memory (or room under the limit) was left
+__attribute__((format(printf, 2, 0))) int
+diagnostics_vadd(struct diagnostics_t *diagnostics, const char *format,
+                 va_list args);
+
+__attribute__((format(printf, 2, 3))) int
+diagnostics_add(struct diagnostics_t *diagnostics, const char *format, ...);
+
+// appends everything collected in source, in order, up to the limit. every
+// diagnostic is a single line, which is how they're told apart
+int diagnostics_append(struct diagnostics_t *diagnostics,
+                       const struct diagnostics_t *source);
+
+// writes out the text collected so far and empties it. the counts stay, so a
+// limit holds across flushes
+void diagnostics_flush(struct diagnostics_t *diagnostics, FILE *file);
+
+void diagnostics_clear(struct diagnostics_t *diagnostics);
+
+void diagnostics_destroy(struct diagnostics_t *diagnostics);
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,94 @@
+#include "hash.h"
+#include <string.h>
+
+#define HASH_PRIME_1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME_3 0x165667B19E3779F9ULL
+#define HASH_PRIME_4 0x85EBCA77C2B2AE63ULL
+#define HASH_PRIME_5 0x27D4EB2F165667C5ULL
+
+static uint64_t rotate_left(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// unaligned little-endian loads
+static uint64_t read64(const unsigned char *p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint32_t read32(const unsigned char *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static uint64_t hash_round(uint64_t accumulator, uint64_t input) {
+  accumulator += input * HASH_PRIME_2;
+  accumulator = rotate_left(accumulator, 31);
+  return accumulator * HASH_PRIME_1;
+}
+
+static uint64_t hash_merge(uint64_t hash, uint64_t lane) {
+  hash ^= hash_round(0, lane);
+  return hash * HASH_PRIME_1 + HASH_PRIME_4;
+}
+
+uint64_t hash_bytes(const void *data, uint64_t length, uint64_t seed) {
+  const unsigned char *p = (const unsigned char *)data;
+  const unsigned char *end = p + length;
+  uint64_t hash;
+
+  if (length >= 32) {
+    // four independent lanes so the multiplies pipeline
+    uint64_t v1 = seed + HASH_PRIME_1 + HASH_PRIME_2;
+    uint64_t v2 = seed + HASH_PRIME_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - HASH_PRIME_1;
+
+    do {
+      v1 = hash_round(v1, read64(p));
+      v2 = hash_round(v2, read64(p + 8));
+      v3 = hash_round(v3, read64(p + 16));
+      v4 = hash_round(v4, read64(p + 24));
+      p += 32;
+    } while (end - p >= 32);
+
+    hash = rotate_left(v1, 1) + rotate_left(v2, 7) + rotate_left(v3, 12) +
+           rotate_left(v4, 18);
+    hash = hash_merge(hash, v1);
+    hash = hash_merge(hash, v2);
+    hash = hash_merge(hash, v3);
+    hash = hash_merge(hash, v4);
+  } else {
+    hash = seed + HASH_PRIME_5;
+  }
+
+  hash += length;
+
+  for (; end - p >= 8; p += 8) {
+    hash ^= hash_round(0, read64(p));
+    hash = rotate_left(hash, 27) * HASH_PRIME_1 + HASH_PRIME_4;
+  }
+
+  if (end - p >= 4) {
+    hash ^= (uint64_t)read32(p) * HASH_PRIME_1;
+    hash = rotate_left(hash, 23) * HASH_PRIME_2 + HASH_PRIME_3;
+    p += 4;
+  }
+
+  for (; p < end; p++) {
+    hash ^= (uint64_t)*p * HASH_PRIME_5;
+    hash = rotate_left(hash, 11) * HASH_PRIME_1;
+  }
+
+  // final avalanche
+  hash ^= hash >> 33;
+  hash *= HASH_PRIME_2;
+  hash ^= hash >> 29;
+  hash *= HASH_PRIME_3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
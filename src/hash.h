@@ -0,0 +1,10 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+
+// fast non-cryptographic 64-bit hash (XXH64 construction) for content
+// addressing and hash tables; eats 32 bytes per round on large inputs
+uint64_t hash_bytes(const void *data, uint64_t length, uint64_t seed);
+
+#endif // HASH_H
@@ -0,0 +1,108 @@
+#include "intern.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INTERN_INITIAL_CAPACITY 256
+#define INTERN_ARENA_BLOCK_SIZE (16 * 1024)
+
+struct interner_t *interner_create(const struct allocator_t *allocator) {
+  struct interner_t *interner = (struct interner_t *)alloc_zeroed(
+      allocator, sizeof(struct interner_t));
+
+  if (interner == NULL) {
+    LOG_ERROR("interner_create: error allocating memory for interner");
+    return NULL;
+  }
+
+  interner->symbols.allocator = allocator;
+  interner->table = table_create(INTERN_INITIAL_CAPACITY, allocator);
+  interner->arena = arena_create(INTERN_ARENA_BLOCK_SIZE, allocator);
+
+  if (interner->table == NULL || interner->arena == NULL ||
+      !intern_symbols_reserve(&interner->symbols, INTERN_INITIAL_CAPACITY)) {
+    LOG_ERROR("interner_create: error allocating memory for symbols");
+    interner_destroy(interner);
+    return NULL;
+  }
+
+  return interner;
+}
+
+uint32_t interner_intern(struct interner_t *interner, const char *text,
+                         uint64_t length) {
+  uint64_t hash = table_hash(text, length);
+  struct table_entry_t *entry =
+      table_find(interner->table, text, length, hash);
+
+  if (entry != NULL)
+    return (uint32_t)entry->value;
+
+  // ids are 32-bit and INTERN_NO_SYMBOL is taken
+  if (interner->symbols.size == INTERN_NO_SYMBOL ||
+      !intern_symbols_grow(&interner->symbols, 1)) {
+    LOG_ERROR("interner_intern: error growing symbol list");
+    return INTERN_NO_SYMBOL;
+  }
+
+  // the table keys on the copy, the caller's buffer can go away
+  char *copy = arena_strndup(interner->arena, text, length);
+  int inserted;
+
+  if (copy == NULL ||
+      (entry = table_insert(interner->table, copy, length, hash,
+                            &inserted)) == NULL) {
+    LOG_ERROR("interner_intern: error allocating memory for symbol");
+    return INTERN_NO_SYMBOL;
+  }
+
+  uint32_t symbol = (uint32_t)interner->symbols.size;
+  struct intern_symbol_t interned = {
+      .text = copy,
+      .length = length,
+      .hash = hash,
+  };
+
+  // can't fail, the room was made above
+  intern_symbols_push(&interner->symbols, interned);
+  entry->value = symbol;
+
+  return symbol;
+}
+
+uint32_t interner_find(const struct interner_t *interner, const char *text,
+                       uint64_t length) {
+  struct table_entry_t *entry =
+      table_find(interner->table, text, length, table_hash(text, length));
+
+  return entry != NULL ? (uint32_t)entry->value : INTERN_NO_SYMBOL;
+}
+
+const struct intern_symbol_t *interner_symbol(const struct interner_t *interner,
+                                              uint32_t symbol) {
+  return &interner->symbols.data[symbol];
+}
+
+void interner_clear(struct interner_t *interner) {
+  table_clear(interner->table);
+  arena_reset(interner->arena);
+  intern_symbols_clear(&interner->symbols);
+}
+
+void interner_destroy(struct interner_t *interner) {
+  if (interner == NULL) {
+    LOG_ERROR("interner_destroy: null interner provided");
+    return;
+  }
+
+  if (interner->table != NULL)
+    table_destroy(interner->table);
+
+  if (interner->arena != NULL)
+    arena_destroy(interner->arena);
+
+  const struct allocator_t *allocator = interner->symbols.allocator;
+
+  intern_symbols_release(&interner->symbols);
+  alloc_release(allocator, interner, sizeof(struct interner_t));
+}
@@ -0,0 +1,55 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "arena.h"
+#include "table.h"
+#include "vec.h"
+#include <stdint.h>
+
+// gives every distinct string a dense symbol id, 0, 1, 2, ... in order of
+// first appearance. each string is copied once, so later stages can compare
+// names by id and keep the text and hash around without holding on to the
+// source buffer
+
+// what interner_intern returns when it runs out of memory
+#define INTERN_NO_SYMBOL UINT32_MAX
+
+struct intern_symbol_t {
+  // owned by the interner, NUL-terminated for convenience
+  const char *text;
+  uint64_t length;
+  uint64_t hash;
+};
+
+VEC_DEFINE(intern_symbols, struct intern_symbol_t)
+
+struct interner_t {
+  // text -> symbol id, keyed on the copies in the arena
+  struct table_t *table;
+  struct arena_t *arena;
+  // indexed by symbol id
+  struct intern_symbols_t symbols;
+};
+
+// allocator is where the interner and its copies come from, NULL for malloc
+struct interner_t *interner_create(const struct allocator_t *allocator);
+
+// the symbol for text[0, length), which needs no terminator. adds it the
+// first time it's seen
+uint32_t interner_intern(struct interner_t *interner, const char *text,
+                         uint64_t length);
+
+// the symbol for text[0, length) if it has been interned, INTERN_NO_SYMBOL
+// otherwise
+uint32_t interner_find(const struct interner_t *interner, const char *text,
+                       uint64_t length);
+
+// symbol must have come from this interner
+const struct intern_symbol_t *interner_symbol(const struct interner_t *interner,
+                                              uint32_t symbol);
+
+void interner_clear(struct interner_t *interner);
+
+void interner_destroy(struct interner_t *interner);
+
+#endif // INTERN_H
@@ -0,0 +1,59 @@
+#include "keyword.h"
+#include <string.h>
+
+// perfect hash over the reserved words: the first two characters and the
+// length are enough to give all sixteen a distinct slot out of 32, so a lookup
+// is one hash, one table load and at most one memcmp. every keyword is 2..6
+// characters long, anything else can't be one
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 6
+#define KEYWORD_SLOTS 32
+
+#define KEYWORD_SLOT(first, second, length)                                    \
+  (((unsigned)(first) * 4 + (unsigned)(second) * 3 + (unsigned)(length)) &     \
+   (KEYWORD_SLOTS - 1))
+
+// the leading characters are spelled out because indexing a string literal
+// isn't a constant expression
+#define KEYWORD_ENTRY(first, second, word, token)                              \
+  [KEYWORD_SLOT(first, second, sizeof(word) - 1)] = {word, sizeof(word) - 1,   \
+                                                     token}
+
+struct keyword_entry_t {
+  const char *text;
+  uint8_t length;
+  TokenType type;
+};
+
+// slots are placed by the compiler, empty ones have length 0 and never match
+static const struct keyword_entry_t keyword_table[KEYWORD_SLOTS] = {
+    KEYWORD_ENTRY('a', 'n', "and", AND),
+    KEYWORD_ENTRY('c', 'l', "class", CLASS),
+    KEYWORD_ENTRY('e', 'l', "else", ELSE),
+    KEYWORD_ENTRY('f', 'a', "false", FALSE),
+    KEYWORD_ENTRY('f', 'o', "for", FOR),
+    KEYWORD_ENTRY('f', 'u', "fun", FUN),
+    KEYWORD_ENTRY('i', 'f', "if", IF),
+    KEYWORD_ENTRY('n', 'i', "nil", NIL),
+    KEYWORD_ENTRY('o', 'r', "or", OR),
+    KEYWORD_ENTRY('p', 'r', "print", PRINT),
+    KEYWORD_ENTRY('r', 'e', "return", RETURN),
+    KEYWORD_ENTRY('s', 'u', "super", SUPER),
+    KEYWORD_ENTRY('t', 'h', "this", THIS),
+    KEYWORD_ENTRY('t', 'r', "true", TRUE),
+    KEYWORD_ENTRY('v', 'a', "var", VAR),
+    KEYWORD_ENTRY('w', 'h', "while", WHILE),
+};
+
+TokenType keyword_lookup(const char *text, uint64_t length) {
+  if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH)
+    return IDENTIFIER;
+
+  const struct keyword_entry_t *entry =
+      &keyword_table[KEYWORD_SLOT(text[0], text[1], length)];
+
+  if (entry->length == length && memcmp(entry->text, text, length) == 0)
+    return entry->type;
+
+  return IDENTIFIER;
+}
@@ -0,0 +1,11 @@
+#ifndef KEYWORD_H
+#define KEYWORD_H
+
+#include "token.h"
+#include <stdint.h>
+
+// returns the keyword's token type, or IDENTIFIER if text[0, length) isn't a
+// reserved word. works on the source span directly, no terminator needed
+TokenType keyword_lookup(const char *text, uint64_t length);
+
+#endif // KEYWORD_H
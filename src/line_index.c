@@ -0,0 +1,77 @@
+#include "line_index.h"
+#include "log.h"
+#include "simd.h"
+#include "utf8.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+struct line_index_t *line_index_create(const struct allocator_t *allocator) {
+  struct line_index_t *index = (struct line_index_t *)alloc_zeroed(
+      allocator, sizeof(struct line_index_t));
+
+  if (index == NULL) {
+    LOG_ERROR("line_index_create: error allocating memory for line index");
+    return NULL;
+  }
+
+  index->starts.allocator = allocator;
+
+  return index;
+}
+
+int line_index_build(struct line_index_t *index, const char *data,
+                     uint64_t length) {
+  line_starts_clear(&index->starts);
+
+  if (!line_starts_push(&index->starts, 0))
+    return 0;
+
+  // jump from newline to newline with the same kernel that skips comments
+  uint64_t at = simd_find_line_end(data, length);
+
+  while (at < length) {
+    if (!line_starts_push(&index->starts, at + 1))
+      return 0;
+
+    at += 1 + simd_find_line_end(data + at + 1, length - at - 1);
+  }
+
+  return 1;
+}
+
+uint64_t line_index_line(const struct line_index_t *index, uint64_t offset) {
+  // lines starting at or before offset
+  uint64_t low = 0;
+  uint64_t high = index->starts.size;
+
+  while (low < high) {
+    uint64_t mid = low + (high - low) / 2;
+
+    if (index->starts.data[mid] <= offset)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+uint64_t line_index_column(const struct line_index_t *index, const char *data,
+                           uint64_t offset) {
+  uint64_t line = line_index_line(index, offset);
+  uint64_t start = index->starts.data[line - 1];
+
+  return utf8_count_code_points(data + start, offset - start) + 1;
+}
+
+void line_index_destroy(struct line_index_t *index) {
+  if (index == NULL) {
+    LOG_ERROR("line_index_destroy: null line index provided");
+    return;
+  }
+
+  const struct allocator_t *allocator = index->starts.allocator;
+
+  line_starts_release(&index->starts);
+  alloc_release(allocator, index, sizeof(struct line_index_t));
+}
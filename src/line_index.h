@@ -0,0 +1,36 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include "vec.h"
+#include <stdint.h>
+
+VEC_DEFINE(line_starts, uint64_t)
+
+// where every line of a buffer starts. the scanner doesn't track lines, so
+// this is built the first time a diagnostic (or anything else positioned)
+// needs one, and turns offsets into line and column numbers from then on
+struct line_index_t {
+  // starts.data[i] is the offset of the first byte of line i + 1, the first
+  // is 0
+  struct line_starts_t starts;
+};
+
+// allocator is where the index and its storage come from, NULL for malloc
+struct line_index_t *line_index_create(const struct allocator_t *allocator);
+
+// indexes data[0, length), replacing whatever was indexed before. returns 0
+// if it runs out of memory
+int line_index_build(struct line_index_t *index, const char *data,
+                     uint64_t length);
+
+// 1-based line of the byte at offset
+uint64_t line_index_line(const struct line_index_t *index, uint64_t offset);
+
+// 1-based column of the byte at offset, counted in code points. data is the
+// buffer that was indexed
+uint64_t line_index_column(const struct line_index_t *index, const char *data,
+                           uint64_t offset);
+
+void line_index_destroy(struct line_index_t *index);
+
+#endif // LINE_INDEX_H
@@ -0,0 +1,15 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+
+// LOG_ERROR for the files that make up liblox. they report every failure
+// through a return value as well, so the library build (LOX_QUIET), which
+// must never write to stderr, can leave the messages out
+#ifdef LOX_QUIET
+#define LOG_ERROR(msg, ...) ((void)0)
+#else
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+#endif
+
+#endif // LOG_H
@@ -0,0 +1,259 @@
+#include "lox.h"
+#include "alloc.h"
+#include "diagnostics.h"
+#include "intern.h"
+#include "log.h"
+#include "parser.h"
+#include "token.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// the public numbering is the scanner's own, so tokens are handed out without
+// a lookup
+#define LOX_SAME_TYPE(name)                                                    \
+  _Static_assert((int)LOX_TOKEN_##name == (int)name, "LOX_TOKEN_" #name)
+
+LOX_SAME_TYPE(LEFT_PAREN);
+LOX_SAME_TYPE(RIGHT_PAREN);
+LOX_SAME_TYPE(LEFT_BRACE);
+LOX_SAME_TYPE(RIGHT_BRACE);
+LOX_SAME_TYPE(COMMA);
+LOX_SAME_TYPE(DOT);
+LOX_SAME_TYPE(MINUS);
+LOX_SAME_TYPE(PLUS);
+LOX_SAME_TYPE(SEMICOLON);
+LOX_SAME_TYPE(SLASH);
+LOX_SAME_TYPE(STAR);
+LOX_SAME_TYPE(BANG);
+LOX_SAME_TYPE(BANG_EQUAL);
+LOX_SAME_TYPE(EQUAL);
+LOX_SAME_TYPE(EQUAL_EQUAL);
+LOX_SAME_TYPE(GREATER);
+LOX_SAME_TYPE(GREATER_EQUAL);
+LOX_SAME_TYPE(LESS);
+LOX_SAME_TYPE(LESS_EQUAL);
+LOX_SAME_TYPE(IDENTIFIER);
+LOX_SAME_TYPE(STRING);
+LOX_SAME_TYPE(NUMBER);
+LOX_SAME_TYPE(AND);
+LOX_SAME_TYPE(CLASS);
+LOX_SAME_TYPE(ELSE);
+LOX_SAME_TYPE(FALSE);
+LOX_SAME_TYPE(FUN);
+LOX_SAME_TYPE(FOR);
+LOX_SAME_TYPE(IF);
+LOX_SAME_TYPE(NIL);
+LOX_SAME_TYPE(OR);
+LOX_SAME_TYPE(PRINT);
+LOX_SAME_TYPE(RETURN);
+LOX_SAME_TYPE(SUPER);
+LOX_SAME_TYPE(THIS);
+LOX_SAME_TYPE(TRUE);
+LOX_SAME_TYPE(VAR);
+LOX_SAME_TYPE(WHILE);
+_Static_assert((int)LOX_TOKEN_EOF == (int)END_OF_FILE, "LOX_TOKEN_EOF");
+
+struct lox_lexer_t {
+  // what the parser allocates from, capped by lox_lexer_set_max_memory
+  struct counting_allocator_t budget;
+  struct parser_t *parser;
+  lox_diagnostic_sink_t diagnostic_sink;
+  void *diagnostic_context;
+  uint64_t max_errors;
+  // errors seen in the current lox_lex call, delivered or not
+  uint64_t errors;
+  struct lox_token_t batch[LOX_TOKEN_BATCH];
+};
+
+// parser->report for a lexer: applies the limit and passes the message on
+// without its newline
+static void lox_report(void *context, const char *text, uint64_t length) {
+  struct lox_lexer_t *lexer = (struct lox_lexer_t *)context;
+  uint64_t count = ++lexer->errors;
+
+  if (lexer->diagnostic_sink == NULL)
+    return;
+
+  struct parser_t *parser = lexer->parser;
+  struct lox_diagnostic_t diagnostic = {0};
+
+  if (lexer->max_errors != 0 && count > lexer->max_errors) {
+    if (count == lexer->max_errors + 1) {
+      text = DIAGNOSTICS_LIMIT_NOTE;
+      length = sizeof(DIAGNOSTICS_LIMIT_NOTE) - 1;
+    } else {
+      return;
+    }
+  } else {
+    diagnostic.offset = parser->start;
+    diagnostic.line = parser_line(parser, parser->start);
+    diagnostic.column = parser_column(parser, parser->start);
+  }
+
+  if (length > 0 && text[length - 1] == '\n')
+    length--;
+
+  diagnostic.message = text;
+  diagnostic.length = (size_t)length;
+
+  lexer->diagnostic_sink(lexer->diagnostic_context, &diagnostic);
+}
+
+struct lox_lexer_t *lox_lexer_create(void) {
+  struct lox_lexer_t *lexer =
+      (struct lox_lexer_t *)calloc(1, sizeof(struct lox_lexer_t));
+
+  if (lexer == NULL) {
+    LOG_ERROR("lox_lexer_create: error allocating memory for lexer");
+    return NULL;
+  }
+
+  counting_allocator_init(&lexer->budget, NULL, 0);
+  lexer->parser = parser_create(&lexer->budget.allocator);
+
+  if (lexer->parser == NULL) {
+    LOG_ERROR("lox_lexer_create: error creating parser");
+    free(lexer);
+    return NULL;
+  }
+
+  lexer->parser->report = lox_report;
+  lexer->parser->report_context = lexer;
+
+  return lexer;
+}
+
+void lox_lexer_set_diagnostic_sink(struct lox_lexer_t *lexer,
+                                   lox_diagnostic_sink_t sink, void *context) {
+  lexer->diagnostic_sink = sink;
+  lexer->diagnostic_context = context;
+}
+
+void lox_lexer_set_max_errors(struct lox_lexer_t *lexer, uint64_t max_errors) {
+  lexer->max_errors = max_errors;
+}
+
+int lox_lexer_set_interning(struct lox_lexer_t *lexer, int enabled) {
+  struct parser_t *parser = lexer->parser;
+
+  if (!enabled) {
+    if (parser->interner != NULL) {
+      interner_destroy(parser->interner);
+      parser->interner = NULL;
+    }
+
+    return 1;
+  }
+
+  // the symbols count against the memory limit like the rest of the lexer
+  if (parser->interner == NULL)
+    parser->interner = interner_create(&lexer->budget.allocator);
+
+  return parser->interner != NULL;
+}
+
+void lox_lexer_set_max_memory(struct lox_lexer_t *lexer, uint64_t max_memory) {
+  lexer->budget.limit = max_memory;
+}
+
+enum lox_status_t lox_lex(struct lox_lexer_t *lexer, const char *source,
+                          size_t length, lox_token_sink_t sink,
+                          void *context) {
+  struct parser_t *parser = lexer->parser;
+  struct token_entry_t entry;
+  size_t count = 0;
+
+  parser_reset(parser);
+  parser_begin(parser, source, (uint64_t)length);
+  lexer->errors = 0;
+
+  // a token that couldn't be stored is gone, so stop short of handing out
+  // anything after it
+  while (parser_next_token(parser, &entry) && !parser->out_of_memory) {
+    struct lox_token_t *token = &lexer->batch[count++];
+
+    token->type = (enum lox_token_type_t)entry.type;
+    token->offset = entry.offset;
+    token->length = entry.length;
+    token->number = entry.type == NUMBER ? entry.value.number : 0;
+    token->literal = NULL;
+    token->literal_length = 0;
+    token->symbol = LOX_NO_SYMBOL;
+
+    if (parser->interner != NULL &&
+        (entry.type == IDENTIFIER || entry.type == STRING)) {
+      token->symbol = entry.value.symbol;
+    }
+
+    // an interned literal is the symbol's text, see token_value_t
+    if (entry.type == STRING && parser->interner != NULL) {
+      const struct intern_symbol_t *symbol =
+          interner_symbol(parser->interner, entry.value.symbol);
+
+      token->literal = symbol->text;
+      token->literal_length = (size_t)symbol->length;
+    } else if (entry.type == STRING) {
+      uint64_t literal_length;
+
+      token->literal = token_string_literal(source, entry.offset, entry.length,
+                                            entry.value, &literal_length);
+      token->literal_length = (size_t)literal_length;
+    }
+
+    if (count == LOX_TOKEN_BATCH) {
+      if (sink(context, lexer->batch, count) != 0)
+        return LOX_STOPPED;
+
+      count = 0;
+
+      // the batch was the only thing holding on to decoded literals, unless
+      // a token scanned ahead still is
+      if (parser->tokens->size == 0)
+        arena_reset(parser->arena);
+    }
+  }
+
+  // EOF is always last (short of running out of memory), so there's at least
+  // that left unless it exactly filled the previous batch
+  if (count > 0 && sink(context, lexer->batch, count) != 0)
+    return LOX_STOPPED;
+
+  if (parser->out_of_memory)
+    return LOX_OUT_OF_MEMORY;
+
+  return parser->error ? LOX_LEXICAL_ERROR : LOX_OK;
+}
+
+void lox_lexer_reset(struct lox_lexer_t *lexer) {
+  struct parser_t *parser = lexer->parser;
+
+  parser_reset(parser);
+
+  // the only thing that grows with the input is the newline index built for
+  // the first error, everything else stays at its first size
+  if (parser->lines != NULL) {
+    line_index_destroy(parser->lines);
+    parser->lines = NULL;
+  }
+
+  if (parser->interner != NULL)
+    interner_clear(parser->interner);
+}
+
+void lox_lexer_destroy(struct lox_lexer_t *lexer) {
+  if (lexer == NULL) {
+    LOG_ERROR("lox_lexer_destroy: null lexer provided");
+    return;
+  }
+
+  // the parser doesn't own its interner
+  if (lexer->parser->interner != NULL)
+    interner_destroy(lexer->parser->interner);
+
+  parser_destroy(lexer->parser);
+  free(lexer);
+}
+
+const char *lox_token_type_name(enum lox_token_type_t type) {
+  return token_type_name((TokenType)type);
+}
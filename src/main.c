@@ -1,84 +1,304 @@
-#include "arraylist.h"
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "alloc.h"
+#include "batch.h"
+#include "parallel_parser.h"
 #include "parser.h"
+#include "serve.h"
 
-#include "token.h"
+#include "tokenize.h"
 
-char *read_file_contents(const char *filename);
+#define OUTPUT_BUFFER_SIZE (256 * 1024)
 
-int main(int argc, char *argv[]) {
-  // Disable output buffering
-  setbuf(stdout, NULL);
-  setbuf(stderr, NULL);
+#define USAGE                                                                  \
+  "Usage: ./your_program tokenize [--stream] [--emit=text|binary] "            \
+  "[--cache-dir DIR] [--threads N] [--stats[=text|json]] "                     \
+  "[--stats-file PATH] [--max-errors N] [--max-memory BYTES[K|M|G]] "          \
+  "<file|directory|@listfile>...\n"                                            \
+  "       ./your_program serve --socket PATH [--threads N] "                   \
+  "[--max-memory BYTES[K|M|G]]\n"
 
-  struct parser_t *parser = parser_create();
+// parses a thread count, returns 0 if it isn't a plain number
+static int parse_thread_count(const char *text, uint32_t *threads) {
+  char *end;
+  unsigned long value = strtoul(text, &end, 10);
 
-  if (argc < 3) {
-    fprintf(stderr, "Usage: ./your_program tokenize <filename>\n");
-    return 1;
-  }
+  if (*text == '\0' || *end != '\0' || value > PARALLEL_PARSER_MAX_THREADS)
+    return 0;
 
-  const char *command = argv[1];
+  *threads = (uint32_t)value;
+  return 1;
+}
 
-  if (strcmp(command, "tokenize") == 0) {
-    // You can use print statements as follows for debugging, they'll be visible
-    // when running tests.
-    fprintf(stderr, "Logs from your program will appear here!\n");
+// parses a --max-errors count, 0 (no limit) included
+static int parse_error_count(const char *text, uint64_t *count) {
+  char *end;
+  unsigned long long value = strtoull(text, &end, 10);
+
+  if (*text == '\0' || *text == '-' || *end != '\0')
+    return 0;
+
+  *count = (uint64_t)value;
+  return 1;
+}
+
+// parses a --max-memory size: a byte count, optionally with a K, M or G
+// suffix (powers of 1024). 0 means no limit
+static int parse_memory_size(const char *text, uint64_t *bytes) {
+  char *end;
+  unsigned long long value = strtoull(text, &end, 10);
+  unsigned shift = 0;
+
+  if (*text == '\0' || *text == '-' || end == text)
+    return 0;
+
+  if (*end == 'K' || *end == 'k')
+    shift = 10;
+  else if (*end == 'M' || *end == 'm')
+    shift = 20;
+  else if (*end == 'G' || *end == 'g')
+    shift = 30;
 
-    char *file_contents = read_file_contents(argv[2]);
+  if (shift != 0)
+    end++;
 
-    // Uncomment this block to pass the first stage
-    parser_parse(parser, file_contents);
+  if (*end != '\0' || value > UINT64_MAX >> shift)
+    return 0;
 
-    struct arraylist_t *tokens = parser_get_tokens(parser);
+  *bytes = (uint64_t)value << shift;
+  return 1;
+}
+
+// returns 0 on a usage error
+static int parse_tokenize_options(int argc, char *argv[],
+                                  struct tokenize_options_t *options) {
+  for (int i = 2; i < argc; i++) {
+    const char *arg = argv[i];
 
-    for (int i = 0; i < tokens->size; i++) {
-      print_token_entry((struct token_entry_t *)tokens->data[i]);
+    if (strcmp(arg, "--stream") == 0) {
+      options->stream = 1;
+    } else if (strcmp(arg, "--emit=text") == 0) {
+      options->binary = 0;
+    } else if (strcmp(arg, "--emit=binary") == 0) {
+      options->binary = 1;
+    } else if (strcmp(arg, "--cache-dir") == 0 && i + 1 < argc) {
+      options->cache_dir = argv[++i];
+    } else if (strncmp(arg, "--cache-dir=", 12) == 0) {
+      options->cache_dir = arg + 12;
+    } else if (strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+      if (!parse_thread_count(argv[++i], &options->threads))
+        return 0;
+      options->threads_given = 1;
+    } else if (strncmp(arg, "--threads=", 10) == 0) {
+      if (!parse_thread_count(arg + 10, &options->threads))
+        return 0;
+      options->threads_given = 1;
+    } else if (strcmp(arg, "--stats") == 0 ||
+               strcmp(arg, "--stats=text") == 0) {
+      options->stats = 1;
+      options->stats_format = STATS_FORMAT_TEXT;
+    } else if (strcmp(arg, "--stats=json") == 0) {
+      options->stats = 1;
+      options->stats_format = STATS_FORMAT_JSON;
+    } else if (strcmp(arg, "--stats-file") == 0 && i + 1 < argc) {
+      options->stats = 1;
+      options->stats_file = argv[++i];
+    } else if (strncmp(arg, "--stats-file=", 13) == 0) {
+      options->stats = 1;
+      options->stats_file = arg + 13;
+    } else if (strcmp(arg, "--max-errors") == 0 && i + 1 < argc) {
+      if (!parse_error_count(argv[++i], &options->max_errors))
+        return 0;
+    } else if (strncmp(arg, "--max-errors=", 13) == 0) {
+      if (!parse_error_count(arg + 13, &options->max_errors))
+        return 0;
+    } else if (strcmp(arg, "--max-memory") == 0 && i + 1 < argc) {
+      if (!parse_memory_size(argv[++i], &options->max_memory))
+        return 0;
+    } else if (strncmp(arg, "--max-memory=", 13) == 0) {
+      if (!parse_memory_size(arg + 13, &options->max_memory))
+        return 0;
+    } else if (arg[0] != '-' || arg[1] == '\0') {
+      options->inputs[options->input_count++] = argv[i];
+    } else {
+      return 0;
     }
+  }
 
-    free(file_contents);
-  } else {
-    fprintf(stderr, "Unknown command: %s\n", command);
-    return 1;
+  // binary streams, cache entries, split scans and batches need whole inputs
+  if (options->stream &&
+      (options->binary || options->cache_dir != NULL ||
+       options->threads_given || options->input_count != 1))
+    return 0;
+
+  return options->input_count > 0;
+}
+
+static int tokenize(struct parser_t *parser, struct output_t *out,
+                    const struct tokenize_options_t *options,
+                    struct stats_t *stats) {
+  if (batch_wanted(options)) {
+    struct path_list_t files = {0};
+
+    int collected = batch_collect(options, &files);
+    int exit_code = batch_tokenize(&files, out, options, stats);
+
+    if (stats != NULL)
+      stats->vector_resizes += files.resizes;
+
+    batch_release(&files);
+
+    return collected ? exit_code : 1;
   }
 
-  if (parser->error) {
-    return 65;
+  const char *filename = options->inputs[0];
+
+  // "-" can't be mapped anyway, so stdin streams unless the whole input is
+  // needed up front
+  if (options->stream ||
+      (strcmp(filename, "-") == 0 && !options->binary &&
+       options->cache_dir == NULL && !options->threads_given)) {
+    int ok = tokenize_stream(parser, out, filename, options, stats);
+    return !ok ? 1 : parser->error ? 65 : 0;
+  }
+
+  return tokenize_file(parser, out, NULL, filename, options, stats);
+}
+
+// returns 0 on a usage error
+static int parse_serve_options(int argc, char *argv[],
+                               struct serve_options_t *options) {
+  for (int i = 2; i < argc; i++) {
+    const char *arg = argv[i];
+
+    if (strcmp(arg, "--socket") == 0 && i + 1 < argc) {
+      options->socket_path = argv[++i];
+    } else if (strncmp(arg, "--socket=", 9) == 0) {
+      options->socket_path = arg + 9;
+    } else if (strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+      if (!parse_thread_count(argv[++i], &options->threads))
+        return 0;
+    } else if (strncmp(arg, "--threads=", 10) == 0) {
+      if (!parse_thread_count(arg + 10, &options->threads))
+        return 0;
+    } else if (strcmp(arg, "--max-memory") == 0 && i + 1 < argc) {
+      if (!parse_memory_size(argv[++i], &options->max_memory))
+        return 0;
+    } else if (strncmp(arg, "--max-memory=", 13) == 0) {
+      if (!parse_memory_size(arg + 13, &options->max_memory))
+        return 0;
+    } else {
+      return 0;
+    }
   }
 
-  return 0;
+  return options->socket_path != NULL && options->socket_path[0] != '\0';
 }
 
-char *read_file_contents(const char *filename) {
-  FILE *file = fopen(filename, "r");
+// times the whole run (output included) and reports it, returns 0 if the
+// report couldn't be written. budget is what parser allocates from
+static int tokenize_with_stats(struct parser_t *parser, struct output_t *out,
+                               const struct tokenize_options_t *options,
+                               const struct counting_allocator_t *budget,
+                               int *exit_code) {
+  struct stats_t stats = {0};
+  double start = stats_clock();
+
+  *exit_code = tokenize(parser, out, options, &stats);
+  output_flush(out);
+
+  stats.total_seconds = stats_clock() - start;
+
+  // a batch filled this in from its own workers' parsers
+  if (budget->peak > stats.scanner_peak_bytes)
+    stats.scanner_peak_bytes = budget->peak;
+
+  FILE *file = options->stats_file != NULL ? fopen(options->stats_file, "w")
+                                           : stderr;
+
   if (file == NULL) {
-    fprintf(stderr, "Error reading file: %s\n", filename);
-    return NULL;
+    fprintf(stderr, "Error writing stats: %s\n", options->stats_file);
+    return 0;
   }
 
-  fseek(file, 0, SEEK_END);
-  long file_size = ftell(file);
-  rewind(file);
+  int ok = stats_write(&stats, file, options->stats_format);
+
+  if (file != stderr)
+    ok &= fclose(file) == 0;
 
-  char *file_contents = malloc(file_size + 1);
-  if (file_contents == NULL) {
-    fprintf(stderr, "Memory allocation failed\n");
-    fclose(file);
-    return NULL;
+  if (!ok)
+    fprintf(stderr, "Error writing stats: %s\n",
+            options->stats_file != NULL ? options->stats_file : "stderr");
+
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  // Disable output buffering for diagnostics, tokens go through our own
+  // buffered writer instead of stdio
+  setbuf(stderr, NULL);
+
+  if (argc < 3) {
+    fprintf(stderr, USAGE);
+    return 1;
   }
 
-  size_t bytes_read = fread(file_contents, 1, file_size, file);
-  if (bytes_read < file_size) {
-    fprintf(stderr, "Error reading file contents\n");
-    free(file_contents);
-    fclose(file);
-    return NULL;
+  // the limit is filled in once --max-memory has been parsed
+  struct counting_allocator_t budget;
+  counting_allocator_init(&budget, NULL, 0);
+
+  struct parser_t *parser = parser_create(&budget.allocator);
+  struct output_t *out = output_create(STDOUT_FILENO, OUTPUT_BUFFER_SIZE);
+
+  const char *command = argv[1];
+  int exit_code;
+
+  if (strcmp(command, "tokenize") == 0) {
+    // You can use print statements as follows for debugging, they'll be visible
+    // when running tests.
+    fprintf(stderr, "Logs from your program will appear here!\n");
+
+    struct tokenize_options_t options = {
+        .inputs = (char **)calloc((size_t)argc, sizeof(char *)),
+        .threads = 1,
+    };
+
+    if (options.inputs == NULL ||
+        !parse_tokenize_options(argc, argv, &options)) {
+      fprintf(stderr, USAGE);
+      exit_code = 1;
+    } else {
+      budget.limit = options.max_memory;
+
+      if (!options.stats) {
+        exit_code = tokenize(parser, out, &options, NULL);
+      } else if (!tokenize_with_stats(parser, out, &options, &budget,
+                                      &exit_code) &&
+                 exit_code == 0) {
+        // a lost report is a failed run, unless the run had failed anyway
+        exit_code = 1;
+      }
+    }
+
+    free(options.inputs);
+  } else if (strcmp(command, "serve") == 0) {
+    struct serve_options_t options = {0};
+
+    if (!parse_serve_options(argc, argv, &options)) {
+      fprintf(stderr, USAGE);
+      exit_code = 1;
+    } else {
+      exit_code = serve(&options);
+    }
+  } else {
+    fprintf(stderr, "Unknown command: %s\n", command);
+    exit_code = 1;
   }
 
-  file_contents[file_size] = '\0';
-  fclose(file);
+  output_destroy(out);
+  parser_destroy(parser);
 
-  return file_contents;
+  return exit_code;
 }
@@ -0,0 +1,38 @@
+#include "memory_stats.h"
+#include <stddef.h>
+
+// relaxed atomics: threads allocate concurrently, but nothing is ordered by
+// these counts
+static uint64_t allocation_count;
+static uint64_t allocation_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  __atomic_fetch_add(&allocation_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&allocation_bytes, size, __ATOMIC_RELAXED);
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  __atomic_fetch_add(&allocation_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&allocation_bytes, count * size, __ATOMIC_RELAXED);
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+  __atomic_fetch_add(&allocation_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&allocation_bytes, size, __ATOMIC_RELAXED);
+  return __real_realloc(pointer, size);
+}
+
+struct memory_stats_t memory_stats_snapshot(void) {
+  struct memory_stats_t stats = {
+      .allocations = __atomic_load_n(&allocation_count, __ATOMIC_RELAXED),
+      .allocated_bytes = __atomic_load_n(&allocation_bytes, __ATOMIC_RELAXED),
+  };
+
+  return stats;
+}
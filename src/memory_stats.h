@@ -0,0 +1,18 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <stdint.h>
+
+// process-wide heap counters. malloc, calloc and realloc are routed through
+// counting wrappers at link time (-Wl,--wrap=..., see CMakeLists.txt), so
+// every allocation made by our code is seen without touching the call sites
+
+struct memory_stats_t {
+  uint64_t allocations;
+  uint64_t allocated_bytes;
+};
+
+// counts so far; subtract two snapshots for the cost of whatever ran between
+struct memory_stats_t memory_stats_snapshot(void);
+
+#endif // MEMORY_STATS_H
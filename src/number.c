@@ -0,0 +1,500 @@
+#include "number.h"
+#include <stdlib.h>
+#include <string.h>
+
+// integers up to 2^53 are exactly representable, as is every power of ten up
+// to 10^22. a product or quotient of two exact values is rounded once, so it's
+// the correctly rounded result (Clinger's fast path)
+#define NUMBER_MAX_EXACT_MANTISSA ((uint64_t)1 << 53)
+#define NUMBER_MAX_EXACT_POWER 22
+
+// more digits than this may not fit the 64-bit accumulator
+#define NUMBER_MAX_DIGITS 19
+
+// significant digits the slow path hands to strtod. deciding how a decimal
+// rounds to a double never takes more than 768 of them, anything past that
+// only matters as "some nonzero digit follows"
+#define NUMBER_SLOW_DIGITS 800
+
+// room for the digits, the sticky digit, an exponent suffix and the terminator
+#define NUMBER_SLOW_BUFFER_SIZE (NUMBER_SLOW_DIGITS + 32)
+
+static const double exact_powers_of_ten[NUMBER_MAX_EXACT_POWER + 1] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// correctly rounded fallback through strtod. the lexeme is rewritten as
+// "<digits>e<exponent>" so no radix character is involved and the current
+// locale can't change the result. digits past NUMBER_SLOW_DIGITS are folded
+// into a single trailing 1 when any of them is nonzero: that keeps the value
+// on the same side of every rounding boundary, so a fixed buffer is enough
+static double number_parse_slow(const char *text, uint64_t length) {
+  char buffer[NUMBER_SLOW_BUFFER_SIZE];
+  uint64_t digits = 0;
+  int64_t exponent = 0;
+  int in_fraction = 0;
+  int sticky = 0;
+
+  for (uint64_t i = 0; i < length; i++) {
+    char c = text[i];
+
+    if (c == '.') {
+      in_fraction = 1;
+    } else if (digits == 0 && c == '0') {
+      // leading zeros don't take up room
+      exponent -= in_fraction;
+    } else if (digits < NUMBER_SLOW_DIGITS) {
+      buffer[digits++] = c;
+      exponent -= in_fraction;
+    } else {
+      // dropped integer digits still scale the value
+      exponent += !in_fraction;
+      sticky |= c != '0';
+    }
+  }
+
+  if (digits == 0)
+    buffer[digits++] = '0';
+
+  if (sticky) {
+    buffer[digits++] = '1';
+    exponent--;
+  }
+
+  buffer[digits++] = 'e';
+
+  if (exponent < 0) {
+    buffer[digits++] = '-';
+    exponent = -exponent;
+  }
+
+  // written backwards, then copied into place
+  char reversed[24];
+  int count = 0;
+
+  do {
+    reversed[count++] = (char)('0' + exponent % 10);
+    exponent /= 10;
+  } while (exponent != 0);
+
+  while (count > 0)
+    buffer[digits++] = reversed[--count];
+
+  buffer[digits] = '\0';
+
+  return strtod(buffer, NULL);
+}
+
+double number_parse(const char *text, uint64_t length) {
+  uint64_t mantissa = 0;
+  int significant = 0;
+  // power of ten the mantissa has to be scaled by
+  int64_t exponent = 0;
+  int in_fraction = 0;
+
+  for (uint64_t i = 0; i < length; i++) {
+    char c = text[i];
+
+    if (c == '.') {
+      in_fraction = 1;
+      continue;
+    }
+
+    unsigned digit = (unsigned)(c - '0');
+
+    if (significant == 0 && digit == 0) {
+      // leading zeros don't take up precision
+      exponent -= in_fraction;
+      continue;
+    }
+
+    if (significant == NUMBER_MAX_DIGITS) {
+      // out of room; trailing zeros can still be folded into the exponent,
+      // anything else needs the exact path
+      if (digit != 0)
+        return number_parse_slow(text, length);
+
+      exponent += !in_fraction;
+      continue;
+    }
+
+    mantissa = mantissa * 10 + digit;
+    significant++;
+    exponent -= in_fraction;
+  }
+
+  // plain integers: the conversion itself rounds correctly, even past 2^53
+  if (exponent == 0)
+    return (double)mantissa;
+
+  if (mantissa <= NUMBER_MAX_EXACT_MANTISSA) {
+    if (exponent < 0 && exponent >= -NUMBER_MAX_EXACT_POWER)
+      return (double)mantissa / exact_powers_of_ten[-exponent];
+
+    if (exponent > 0 && exponent <= NUMBER_MAX_EXACT_POWER)
+      return (double)mantissa * exact_powers_of_ten[exponent];
+  }
+
+  return number_parse_slow(text, length);
+}
+
+// shortest round-trip formatting. we look for the fewest decimal digits that
+// still convert back to exactly the same double, then lay them out in plain
+// positional notation with at least one fractional digit ("3.0", "0.001")
+// which is what the token output expects. two fast paths cover practically
+// every literal; the rest go through an exact bignum digit generator
+
+#define NUMBER_MAX_SHORTEST_DIGITS 17
+
+// bignum for the exact path, big enough for 2^1075 * 10^324 with headroom
+#define BIGNUM_WORDS 40
+
+struct bignum_t {
+  uint32_t words[BIGNUM_WORDS];
+  int length;
+};
+
+static void bignum_set(struct bignum_t *n, uint64_t value) {
+  n->words[0] = (uint32_t)value;
+  n->words[1] = (uint32_t)(value >> 32);
+  n->length = n->words[1] != 0 ? 2 : n->words[0] != 0 ? 1 : 0;
+}
+
+static void bignum_mul_small(struct bignum_t *n, uint32_t factor) {
+  uint64_t carry = 0;
+
+  for (int i = 0; i < n->length; i++) {
+    uint64_t product = (uint64_t)n->words[i] * factor + carry;
+    n->words[i] = (uint32_t)product;
+    carry = product >> 32;
+  }
+
+  if (carry != 0)
+    n->words[n->length++] = (uint32_t)carry;
+}
+
+static void bignum_mul_pow10(struct bignum_t *n, int power) {
+  for (; power >= 9; power -= 9)
+    bignum_mul_small(n, 1000000000u);
+
+  static const uint32_t small_powers[9] = {
+      1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+  if (power > 0)
+    bignum_mul_small(n, small_powers[power]);
+}
+
+static void bignum_shift_left(struct bignum_t *n, int bits) {
+  if (n->length == 0)
+    return;
+
+  int words = bits / 32;
+  int rest = bits % 32;
+
+  if (rest != 0) {
+    uint32_t carry = 0;
+
+    for (int i = 0; i < n->length; i++) {
+      uint32_t word = n->words[i];
+      n->words[i] = (word << rest) | carry;
+      carry = word >> (32 - rest);
+    }
+
+    if (carry != 0)
+      n->words[n->length++] = carry;
+  }
+
+  if (words != 0) {
+    for (int i = n->length - 1; i >= 0; i--)
+      n->words[i + words] = n->words[i];
+
+    for (int i = 0; i < words; i++)
+      n->words[i] = 0;
+
+    n->length += words;
+  }
+}
+
+static int bignum_compare(const struct bignum_t *a, const struct bignum_t *b) {
+  if (a->length != b->length)
+    return a->length < b->length ? -1 : 1;
+
+  for (int i = a->length - 1; i >= 0; i--) {
+    if (a->words[i] != b->words[i])
+      return a->words[i] < b->words[i] ? -1 : 1;
+  }
+
+  return 0;
+}
+
+static void bignum_add(struct bignum_t *out, const struct bignum_t *a,
+                       const struct bignum_t *b) {
+  const struct bignum_t *longer = a->length >= b->length ? a : b;
+  const struct bignum_t *shorter = longer == a ? b : a;
+  uint64_t carry = 0;
+  int i = 0;
+
+  for (; i < longer->length; i++) {
+    uint64_t sum = (uint64_t)longer->words[i] + carry;
+
+    if (i < shorter->length)
+      sum += shorter->words[i];
+
+    out->words[i] = (uint32_t)sum;
+    carry = sum >> 32;
+  }
+
+  if (carry != 0)
+    out->words[i++] = (uint32_t)carry;
+
+  out->length = i;
+}
+
+// a -= b, requires a >= b
+static void bignum_subtract(struct bignum_t *a, const struct bignum_t *b) {
+  int64_t borrow = 0;
+
+  for (int i = 0; i < a->length; i++) {
+    int64_t difference =
+        (int64_t)a->words[i] - (i < b->length ? b->words[i] : 0) - borrow;
+    borrow = difference < 0;
+    a->words[i] = (uint32_t)(difference + (borrow ? ((int64_t)1 << 32) : 0));
+  }
+
+  while (a->length > 0 && a->words[a->length - 1] == 0)
+    a->length--;
+}
+
+// Burger & Dybvig's free-format algorithm: exact, handles the whole double
+// range, but slow. value must be finite and > 0. writes the significant digits
+// and returns their count; *point is where the decimal point goes relative to
+// them (value = 0.DIGITS * 10^point)
+static int number_shortest_exact(double value, char *digits, int *point) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  int biased = (int)((bits >> 52) & 0x7FF);
+  uint64_t f = bits & (((uint64_t)1 << 52) - 1);
+  int e;
+
+  if (biased == 0) {
+    e = -1074;
+  } else {
+    f |= (uint64_t)1 << 52;
+    e = biased - 1075;
+  }
+
+  // r / s is the value, m_plus / s and m_minus / s are half the gaps to its
+  // neighbours; the gap below is narrower at the bottom of a binade
+  struct bignum_t r, s, m_plus, m_minus;
+  int narrow_below = f == ((uint64_t)1 << 52) && biased > 1;
+
+  bignum_set(&r, f);
+  bignum_set(&s, 1);
+  bignum_set(&m_plus, 1);
+  bignum_set(&m_minus, 1);
+
+  if (e >= 0) {
+    bignum_shift_left(&r, e + 1 + narrow_below);
+    bignum_shift_left(&s, 1 + narrow_below);
+    bignum_shift_left(&m_plus, e + narrow_below);
+    bignum_shift_left(&m_minus, e);
+  } else {
+    bignum_shift_left(&r, 1 + narrow_below);
+    bignum_shift_left(&s, 1 - e + narrow_below);
+    bignum_shift_left(&m_plus, narrow_below);
+  }
+
+  // under round-half-even the boundaries themselves round to us when the
+  // significand is even
+  int inclusive = (f & 1) == 0;
+
+  // estimate the decimal exponent from the binary one; this can only come out
+  // one too small, which the check below fixes
+  int bit_length = 64 - __builtin_clzll(f);
+  double estimate = (e + bit_length - 1) * 0.30102999566398114 - 1e-10;
+  int k = (int)estimate;
+  if (estimate > 0 && estimate != (double)k)
+    k++;
+
+  if (k >= 0) {
+    bignum_mul_pow10(&s, k);
+  } else {
+    bignum_mul_pow10(&r, -k);
+    bignum_mul_pow10(&m_plus, -k);
+    bignum_mul_pow10(&m_minus, -k);
+  }
+
+  struct bignum_t high;
+  bignum_add(&high, &r, &m_plus);
+
+  int compare = bignum_compare(&high, &s);
+  if (inclusive ? compare >= 0 : compare > 0) {
+    bignum_mul_small(&s, 10);
+    k++;
+  }
+
+  *point = k;
+
+  int count = 0;
+
+  for (;;) {
+    bignum_mul_small(&r, 10);
+    bignum_mul_small(&m_plus, 10);
+    bignum_mul_small(&m_minus, 10);
+
+    int digit = 0;
+    while (bignum_compare(&r, &s) >= 0) {
+      bignum_subtract(&r, &s);
+      digit++;
+    }
+
+    // low: rounding down to this digit still lands on value
+    // high: rounding up to the next digit still lands on value
+    compare = bignum_compare(&r, &m_minus);
+    int low = inclusive ? compare <= 0 : compare < 0;
+
+    bignum_add(&high, &r, &m_plus);
+    compare = bignum_compare(&high, &s);
+    int up = inclusive ? compare >= 0 : compare > 0;
+
+    if (!low && !up) {
+      digits[count++] = (char)('0' + digit);
+      continue;
+    }
+
+    if (low && up) {
+      // both work, take whichever is closer and the even one on a tie
+      struct bignum_t twice;
+      bignum_add(&twice, &r, &r);
+      compare = bignum_compare(&twice, &s);
+      up = compare > 0 || (compare == 0 && digit % 2 == 1);
+    }
+
+    digits[count++] = (char)('0' + digit + up);
+    return count;
+  }
+}
+
+// writes value in decimal, returns the digit count
+static int number_write_integer(uint64_t value, char *digits) {
+  char reversed[20];
+  int count = 0;
+
+  do {
+    reversed[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+
+  for (int i = 0; i < count; i++)
+    digits[i] = reversed[count - 1 - i];
+
+  return count;
+}
+
+// shortest digits for a finite value > 0, same contract as
+// number_shortest_exact
+static int number_shortest(double value, char *digits, int *point) {
+  // integers below 2^53 are exact, so their own digits are the answer
+  if (value < (double)NUMBER_MAX_EXACT_MANTISSA &&
+      value == (double)(uint64_t)value) {
+    int count = number_write_integer((uint64_t)value, digits);
+    *point = count;
+    return count;
+  }
+
+  // otherwise try "m / 10^k" for growing k. while 10^-k is wider than the gap
+  // between neighbouring doubles at most one such m can convert back to
+  // value, so the first hit is the shortest representation. the division is
+  // exact-then-rounded-once as long as m < 2^53 and k <= 22
+  uint64_t next_bits;
+  memcpy(&next_bits, &value, sizeof(next_bits));
+  next_bits++;
+
+  double next;
+  memcpy(&next, &next_bits, sizeof(next));
+  double gap = next - value;
+
+  for (int k = 1; k <= NUMBER_MAX_EXACT_POWER; k++) {
+    double scaled = value * exact_powers_of_ten[k];
+
+    if (scaled >= (double)(NUMBER_MAX_EXACT_MANTISSA - 1) ||
+        gap * exact_powers_of_ten[k] > 0.5)
+      break;
+
+    uint64_t m = (uint64_t)(scaled + 0.5);
+
+    // too small for this many fractional digits
+    if (m == 0)
+      continue;
+
+    // the scaling above rounds, so the right m may be a neighbour
+    uint64_t candidates[3] = {m, m - 1, m + 1};
+
+    for (int i = 0; i < 3; i++) {
+      if ((double)candidates[i] / exact_powers_of_ten[k] == value) {
+        int count = number_write_integer(candidates[i], digits);
+        *point = count - k;
+        return count;
+      }
+    }
+  }
+
+  return number_shortest_exact(value, digits, point);
+}
+
+uint64_t number_format(double value, char *buffer) {
+  char *out = buffer;
+
+  if (value != value) {
+    memcpy(out, "NaN", 3);
+    return 3;
+  }
+
+  if (value < 0 || (value == 0 && 1 / value < 0)) {
+    *out++ = '-';
+    value = -value;
+  }
+
+  if (value == 0) {
+    memcpy(out, "0.0", 3);
+    return (uint64_t)(out + 3 - buffer);
+  }
+
+  if (value > 1.7976931348623157e308) {
+    memcpy(out, "Infinity", 8);
+    return (uint64_t)(out + 8 - buffer);
+  }
+
+  char digits[NUMBER_MAX_SHORTEST_DIGITS + 1];
+  int point;
+  int count = number_shortest(value, digits, &point);
+
+  if (point <= 0) {
+    // 0.000ddd
+    *out++ = '0';
+    *out++ = '.';
+    memset(out, '0', (size_t)-point);
+    out += -point;
+    memcpy(out, digits, (size_t)count);
+    out += count;
+  } else if (point < count) {
+    // ddd.ddd
+    memcpy(out, digits, (size_t)point);
+    out += point;
+    *out++ = '.';
+    memcpy(out, digits + point, (size_t)(count - point));
+    out += count - point;
+  } else {
+    // ddd000.0
+    memcpy(out, digits, (size_t)count);
+    out += count;
+    memset(out, '0', (size_t)(point - count));
+    out += point - count;
+    *out++ = '.';
+    *out++ = '0';
+  }
+
+  return (uint64_t)(out - buffer);
+}
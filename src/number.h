@@ -0,0 +1,21 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stdint.h>
+
+// converts a number lexeme (digits, optionally followed by '.' and more
+// digits) to the nearest double. reads text[0, length) only, doesn't depend
+// on the locale and never allocates
+double number_parse(const char *text, uint64_t length);
+
+// enough for any double in positional notation: 309 integer digits for the
+// largest, "0." plus 323 zeros plus a digit for the smallest, and a sign
+#define NUMBER_FORMAT_BUFFER_SIZE 400
+
+// writes the shortest decimal that reads back as exactly value, in plain
+// positional notation with at least one fractional digit ("42.0", "0.1",
+// "1000000000000000000000.0"). buffer needs NUMBER_FORMAT_BUFFER_SIZE bytes,
+// returns the number of bytes written (no terminator)
+uint64_t number_format(double value, char *buffer);
+
+#endif // NUMBER_H
@@ -0,0 +1,202 @@
+#include "output.h"
+#include "log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// writev rejects requests totalling more than SSIZE_MAX, so giant payloads go
+// out in slices of this size
+#define OUTPUT_MAX_WRITE ((uint64_t)1 << 30)
+
+struct output_t *output_create(int fd, uint64_t capacity) {
+  if (capacity == 0) {
+    LOG_ERROR("output_create: cannot have capacity 0, must be > 0");
+    return NULL;
+  }
+
+  struct output_t *out = (struct output_t *)calloc(1, sizeof(struct output_t));
+
+  if (out == NULL) {
+    LOG_ERROR("output_create: error allocating memory for output");
+    return NULL;
+  }
+
+  out->buffer = (char *)malloc(capacity);
+
+  if (out->buffer == NULL) {
+    LOG_ERROR("output_create: error allocating output buffer");
+    free(out);
+    return NULL;
+  }
+
+  out->fd = fd;
+  out->capacity = capacity;
+
+  return out;
+}
+
+struct output_t *output_create_memory(uint64_t capacity) {
+  struct output_t *out = output_create(-1, capacity);
+
+  if (out == NULL)
+    LOG_ERROR("output_create_memory: error creating memory output");
+
+  return out;
+}
+
+// memory outputs keep everything, so they grow to fit instead of flushing
+static int output_grow(struct output_t *out, uint64_t length) {
+  uint64_t capacity = out->capacity;
+
+  while (capacity - out->length < length) {
+    if (capacity > UINT64_MAX / 2) {
+      out->error = 1;
+      return 0;
+    }
+
+    capacity *= 2;
+  }
+
+  char *grown = (char *)realloc(out->buffer, capacity);
+
+  if (grown == NULL) {
+    LOG_ERROR("output_grow: error growing output buffer");
+    out->error = 1;
+    return 0;
+  }
+
+  out->buffer = grown;
+  out->capacity = capacity;
+
+  return 1;
+}
+
+// writes every iovec in full, retrying on short writes
+static void output_writev_all(struct output_t *out, struct iovec *iov,
+                              int count) {
+  while (count > 0 && !out->error) {
+    ssize_t written = writev(out->fd, iov, count);
+
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+
+      out->error = 1;
+      return;
+    }
+
+    // skip past whatever made it out
+    while (count > 0 && (size_t)written >= iov->iov_len) {
+      written -= (ssize_t)iov->iov_len;
+      iov++;
+      count--;
+    }
+
+    if (count > 0) {
+      iov->iov_base = (char *)iov->iov_base + written;
+      iov->iov_len -= (size_t)written;
+    }
+  }
+}
+
+void output_flush(struct output_t *out) {
+  if (out->length == 0 || out->fd < 0)
+    return;
+
+  struct iovec iov = {.iov_base = out->buffer, .iov_len = out->length};
+  output_writev_all(out, &iov, 1);
+
+  out->length = 0;
+}
+
+void output_reset(struct output_t *out) {
+  out->length = 0;
+  out->error = 0;
+}
+
+void output_write(struct output_t *out, const char *data, uint64_t length) {
+  if (length <= out->capacity - out->length) {
+    memcpy(out->buffer + out->length, data, length);
+    out->length += length;
+    return;
+  }
+
+  if (out->fd < 0) {
+    if (output_grow(out, length)) {
+      memcpy(out->buffer + out->length, data, length);
+      out->length += length;
+    }
+
+    return;
+  }
+
+  if (length < out->capacity) {
+    output_flush(out);
+    memcpy(out->buffer, data, length);
+    out->length = length;
+    return;
+  }
+
+  // too big to ever fit, send the buffer and the payload in a single writev
+  // rather than copying it through
+  uint64_t slice = length < OUTPUT_MAX_WRITE ? length : OUTPUT_MAX_WRITE;
+  struct iovec iov[2] = {
+      {.iov_base = out->buffer, .iov_len = out->length},
+      {.iov_base = (void *)data, .iov_len = slice},
+  };
+  output_writev_all(out, iov, 2);
+
+  out->length = 0;
+
+  for (uint64_t done = slice; done < length; done += slice) {
+    slice = length - done < OUTPUT_MAX_WRITE ? length - done : OUTPUT_MAX_WRITE;
+
+    struct iovec rest = {.iov_base = (void *)(data + done), .iov_len = slice};
+    output_writev_all(out, &rest, 1);
+  }
+}
+
+void output_write_char(struct output_t *out, char c) {
+  if (out->length == out->capacity) {
+    if (out->fd < 0)
+      output_grow(out, 1);
+    else
+      output_flush(out);
+
+    // a memory output that couldn't grow drops the byte
+    if (out->length == out->capacity)
+      return;
+  }
+
+  out->buffer[out->length++] = c;
+}
+
+char *output_reserve(struct output_t *out, uint64_t length) {
+  if (length > out->capacity - out->length) {
+    if (out->fd >= 0)
+      output_flush(out);
+    else if (!output_grow(out, length))
+      out->length = 0; // already flagged as failed, the contents are lost
+  }
+
+  return out->buffer + out->length;
+}
+
+void output_commit(struct output_t *out, uint64_t length) {
+  out->length += length;
+}
+
+void output_destroy(struct output_t *out) {
+  if (out == NULL) {
+    LOG_ERROR("output_destroy: null output provided");
+    return;
+  }
+
+  output_flush(out);
+
+  free(out->buffer);
+  free(out);
+}
@@ -0,0 +1,44 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdint.h>
+
+// buffered writer on top of a raw file descriptor. everything is gathered in
+// one large buffer and handed to the kernel in big writes instead of one
+// syscall per printf
+struct output_t {
+  // -1 for a memory output
+  int fd;
+  char *buffer;
+  uint64_t length;
+  uint64_t capacity;
+  // set once a write fails, later writes are dropped
+  uint8_t error;
+};
+
+struct output_t *output_create(int fd, uint64_t capacity);
+
+// output that collects everything in its buffer (growing it as needed) and
+// never writes anywhere; read it back through buffer and length
+struct output_t *output_create_memory(uint64_t capacity);
+
+void output_write(struct output_t *out, const char *data, uint64_t length);
+
+void output_write_char(struct output_t *out, char c);
+
+// returns space for at least length bytes (length must not exceed the
+// capacity) right in the buffer, so formatters can write in place; follow up
+// with output_commit for the bytes actually used
+char *output_reserve(struct output_t *out, uint64_t length);
+
+void output_commit(struct output_t *out, uint64_t length);
+
+void output_flush(struct output_t *out);
+
+// empties a memory output for reuse, keeping its buffer, and clears the error
+void output_reset(struct output_t *out);
+
+// flushes whatever is still buffered
+void output_destroy(struct output_t *out);
+
+#endif // OUTPUT_H
@@ -0,0 +1,324 @@
+#include "parallel_parser.h"
+#include "diagnostics.h"
+#include "simd.h"
+#include "utf8.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+
+// below this a piece isn't worth a thread of its own
+#define PARALLEL_PARSER_MIN_CHUNK (1024 * 1024)
+
+// a piece always starts right after a '\n'. comments end at newlines and every
+// other token stops at one, so the only thing that can be open at a split is a
+// string literal. each piece is therefore scanned twice, once assuming it
+// starts outside a string and once assuming it starts inside one, and the
+// sequential stitch afterwards just follows whichever guess was right
+enum parallel_start_t {
+  PARALLEL_START_NORMAL,
+  PARALLEL_START_IN_STRING,
+  PARALLEL_START_COUNT
+};
+
+struct parallel_chunk_t {
+  const char *source;
+  uint64_t begin;
+  uint64_t end;
+  uint8_t final;
+  // the caller's parser's, so the runs count against the same budget
+  const struct allocator_t *allocator;
+  // '\n's inside the chunk, gives every chunk its starting line up front
+  uint64_t newlines;
+  uint32_t line;
+  // one speculative scan per start state
+  struct parser_t *runs[PARALLEL_START_COUNT];
+  struct diagnostics_t *diagnostics[PARALLEL_START_COUNT];
+  uint64_t stopped[PARALLEL_START_COUNT];
+  uint8_t failed;
+  // picked by the stitch: the real start state, where the chunk's tokens go
+  // in the combined stream and, for a string carried in, where it opened
+  uint8_t state;
+  uint64_t output_index;
+  uint64_t string_start;
+  struct token_stream_t *output;
+};
+
+uint32_t parallel_parser_default_threads(void) {
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return cores < 1 ? 1 : (uint32_t)cores;
+}
+
+// runs task over every chunk, one thread per chunk with the first one on the
+// calling thread. a thread that can't be started just runs inline instead
+static void parallel_run(struct parallel_chunk_t *chunks, uint32_t count,
+                         void *(*task)(void *)) {
+  pthread_t threads[PARALLEL_PARSER_MAX_THREADS];
+  uint8_t started[PARALLEL_PARSER_MAX_THREADS] = {0};
+
+  for (uint32_t i = 1; i < count; i++)
+    started[i] = pthread_create(&threads[i], NULL, task, &chunks[i]) == 0;
+
+  task(&chunks[0]);
+
+  for (uint32_t i = 1; i < count; i++) {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      task(&chunks[i]);
+  }
+}
+
+static void *parallel_count_lines(void *argument) {
+  struct parallel_chunk_t *chunk = (struct parallel_chunk_t *)argument;
+
+  chunk->newlines = simd_count_newlines(chunk->source + chunk->begin,
+                                        chunk->end - chunk->begin);
+
+  return NULL;
+}
+
+static void *parallel_scan(void *argument) {
+  struct parallel_chunk_t *chunk = (struct parallel_chunk_t *)argument;
+
+  // nothing can be carried into the first chunk
+  int states = chunk->begin == 0 ? 1 : PARALLEL_START_COUNT;
+
+  for (int state = 0; state < states; state++) {
+    struct parser_t *run = parser_create(chunk->allocator);
+    struct diagnostics_t *diagnostics = diagnostics_create();
+
+    chunk->runs[state] = run;
+    chunk->diagnostics[state] = diagnostics;
+
+    if (run == NULL || diagnostics == NULL) {
+      chunk->failed = 1;
+      return NULL;
+    }
+
+    // lines are absolute, so diagnostics come out final as they are
+    run->line = chunk->line;
+    run->diagnostics = diagnostics;
+    run->in_string = state == PARALLEL_START_IN_STRING;
+
+    chunk->stopped[state] = parser_scan_range(run, chunk->source, chunk->begin,
+                                              chunk->end, chunk->final);
+
+    if (run->out_of_memory) {
+      chunk->failed = 1;
+      return NULL;
+    }
+  }
+
+  return NULL;
+}
+
+static void *parallel_copy(void *argument) {
+  struct parallel_chunk_t *chunk = (struct parallel_chunk_t *)argument;
+  struct token_stream_t *tokens = chunk->runs[chunk->state]->tokens;
+  struct token_stream_t *output = chunk->output;
+  uint64_t at = chunk->output_index;
+
+  // offsets are relative to the whole source already, so it's a plain copy
+  memcpy(output->types + at, tokens->types, tokens->size * sizeof(uint8_t));
+  memcpy(output->offsets + at, tokens->offsets,
+         tokens->size * sizeof(uint64_t));
+  memcpy(output->lengths + at, tokens->lengths,
+         tokens->size * sizeof(uint32_t));
+  memcpy(output->values + at, tokens->values,
+         tokens->size * sizeof(union token_value_t));
+
+  // a string carried in was scanned as if it opened at the chunk start
+  if (chunk->state == PARALLEL_START_IN_STRING && tokens->size > 0 &&
+      tokens->types[0] == STRING && tokens->offsets[0] == chunk->begin) {
+    output->lengths[at] +=
+        (uint32_t)(output->offsets[at] - chunk->string_start);
+    output->offsets[at] = chunk->string_start;
+  }
+
+  return NULL;
+}
+
+// whether a piece of a string carried across a split is valid UTF-8 without
+// escapes. pieces end at a '\n', so no sequence or escape straddles them
+static int parallel_plain_string(const char *data, uint64_t length) {
+  return utf8_valid_run(data, length) == length &&
+         memchr(data, '\\', length) == NULL;
+}
+
+// cuts the source into at most count pieces, each ending right after a '\n'
+// (or at the end of the source). returns how many pieces were made
+static uint32_t parallel_split(struct parallel_chunk_t *chunks, uint32_t count,
+                               const char *source, uint64_t length,
+                               const struct allocator_t *allocator) {
+  uint64_t begin = 0;
+  uint32_t made = 0;
+
+  while (begin < length && made < count) {
+    uint64_t target = length / count * (made + 1);
+    uint64_t end = length;
+
+    if (target < begin)
+      target = begin;
+
+    if (made + 1 < count && target < length) {
+      end = target + simd_find_line_end(source + target, length - target);
+      end = end < length ? end + 1 : length;
+    }
+
+    chunks[made] = (struct parallel_chunk_t){
+        .source = source,
+        .begin = begin,
+        .end = end,
+        .final = end == length,
+        .allocator = allocator,
+    };
+
+    made++;
+    begin = end;
+  }
+
+  return made;
+}
+
+static void parallel_release(struct parallel_chunk_t *chunks, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    for (int state = 0; state < PARALLEL_START_COUNT; state++) {
+      if (chunks[i].runs[state] != NULL)
+        parser_destroy(chunks[i].runs[state]);
+
+      if (chunks[i].diagnostics[state] != NULL)
+        diagnostics_destroy(chunks[i].diagnostics[state]);
+    }
+  }
+}
+
+void parallel_parser_parse(struct parser_t *parser, const char *source,
+                           uint64_t length, uint32_t threads) {
+  if (threads > PARALLEL_PARSER_MAX_THREADS)
+    threads = PARALLEL_PARSER_MAX_THREADS;
+
+  if (threads > length / PARALLEL_PARSER_MIN_CHUNK)
+    threads = (uint32_t)(length / PARALLEL_PARSER_MIN_CHUNK);
+
+  // the interner isn't shared between threads, and a string split across
+  // chunks would be interned in pieces
+  if (threads < 2 || parser->interner != NULL) {
+    parser_parse(parser, source, length);
+    return;
+  }
+
+  struct parallel_chunk_t chunks[PARALLEL_PARSER_MAX_THREADS];
+  uint32_t count =
+      parallel_split(chunks, threads, source, length, parser->allocator);
+
+  parallel_run(chunks, count, parallel_count_lines);
+
+  uint32_t line = parser->line;
+
+  for (uint32_t i = 0; i < count; i++) {
+    chunks[i].line = line;
+    line += (uint32_t)chunks[i].newlines;
+  }
+
+  parallel_run(chunks, count, parallel_scan);
+
+  // follow the real state from chunk to chunk and lay out the output
+  uint8_t state = PARALLEL_START_NORMAL;
+  uint64_t string_start = 0;
+  uint64_t total = parser->tokens->size;
+  int failed = 0;
+  int rescan = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    struct parallel_chunk_t *chunk = &chunks[i];
+
+    if (chunk->failed) {
+      failed = 1;
+      break;
+    }
+
+    // the run that closes a carried string only checked and decoded its own
+    // part of it. anything but plain text in the parts before, or escapes in
+    // its own, leaves the literal to a sequential scan. so does one already
+    // too long for the stream's 32-bit lengths, which that scan reports
+    if (state == PARALLEL_START_IN_STRING) {
+      struct token_stream_t *carried = chunk->runs[state]->tokens;
+      uint64_t from = chunks[i - 1].begin > string_start ? chunks[i - 1].begin
+                                                         : string_start;
+
+      if (!parallel_plain_string(source + from, chunk->begin - from) ||
+          chunk->end - string_start > UINT32_MAX ||
+          (carried->size > 0 && carried->types[0] == STRING &&
+           carried->offsets[0] == chunk->begin &&
+           carried->values[0].string != NULL)) {
+        rescan = 1;
+        break;
+      }
+    }
+
+    chunk->state = state;
+    chunk->output_index = total;
+    chunk->string_start = string_start;
+    total += chunk->runs[state]->tokens->size;
+
+    uint64_t stopped = chunk->stopped[state];
+
+    // a scan stops early only on a string still open at the chunk end; if it
+    // stopped right at the start, the carried string never closed here
+    if (stopped < chunk->end) {
+      if (state == PARALLEL_START_NORMAL || stopped > chunk->begin)
+        string_start = stopped;
+
+      state = PARALLEL_START_IN_STRING;
+    } else {
+      state = PARALLEL_START_NORMAL;
+    }
+  }
+
+  // unlike running out of memory, a string to rescan is nothing to log
+  if (!rescan && (failed || !token_stream_reserve(parser->tokens, total))) {
+    LOG_ERROR("parallel_parser_parse: falling back to a sequential scan");
+    rescan = 1;
+  }
+
+  if (rescan) {
+    parallel_release(chunks, count);
+    parser_parse(parser, source, length);
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; i++)
+    chunks[i].output = parser->tokens;
+
+  parallel_run(chunks, count, parallel_copy);
+
+  parser->tokens->size = total;
+
+  // decoded literals stay where the runs put them
+  for (uint32_t i = 0; i < count; i++)
+    arena_adopt(parser->arena, chunks[i].runs[chunks[i].state]->arena);
+
+  // diagnostics go out in source order, exactly as a single scan reports them
+  for (uint32_t i = 0; i < count; i++) {
+    struct parser_t *run = chunks[i].runs[chunks[i].state];
+    struct diagnostics_t *diagnostics = chunks[i].diagnostics[chunks[i].state];
+
+    if (parser->diagnostics != NULL)
+      diagnostics_append(parser->diagnostics, diagnostics);
+    else if (diagnostics->length != 0)
+      fwrite(diagnostics->text, 1, diagnostics->length, stderr);
+
+    parser->error |= run->error;
+  }
+
+  parser->source = source;
+  parser->source_length = length;
+  parser->current_idx = length;
+
+  parallel_release(chunks, count);
+}
@@ -0,0 +1,21 @@
+#ifndef PARALLEL_PARSER_H
+#define PARALLEL_PARSER_H
+
+#include "parser.h"
+#include <stdint.h>
+
+// upper bound on worker threads, more than this are never started
+#define PARALLEL_PARSER_MAX_THREADS 64
+
+// same result as parser_parse (tokens, diagnostics in order, error flag and
+// final line) but the source is split at line boundaries and each piece is
+// scanned on its own thread. inputs too small to be worth splitting, parsers
+// with an interner and any failure to set up or finish a split scan
+// (running out of memory included) just take the sequential path
+void parallel_parser_parse(struct parser_t *parser, const char *source,
+                           uint64_t length, uint32_t threads);
+
+// number of online cores, at least 1
+uint32_t parallel_parser_default_threads(void);
+
+#endif // PARALLEL_PARSER_H
@@ -1,114 +1,499 @@
 #include "parser.h"
+#include "keyword.h"
+#include "log.h"
+#include "number.h"
+#include "simd.h"
 #include "token.h"
-
-static int is_digit(char c) { return c >= '0' && c <= '9'; }
-
-static int is_alpha(char c) {
-  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+#include "utf8.h"
+#include <stdarg.h>
+
+// tokens themselves live in the stream, the arena only backs the occasional
+// payload that can't point into the source
+#define PARSER_ARENA_BLOCK_SIZE (16 * 1024)
+
+// typical source runs 3-5 bytes per token; reserving for the dense end up front
+// means a whole-buffer scan usually allocates its stream once. a token takes
+// 21 bytes over the columns (type, offset, 32-bit length, value), so the up
+// front reservation is 7 bytes per source byte
+#define PARSER_BYTES_PER_TOKEN 3
+
+// fits any error the scanner reports today
+#define PARSER_REPORT_BUFFER_SIZE 256
+
+// what a byte can start, so the scanner dispatches on a single table load
+// instead of a chain of range checks
+enum parser_char_class_t {
+  // can't start a token
+  CHAR_INVALID,
+  // ' ', '\t', '\r' and '\n'
+  CHAR_SPACE,
+  // a token by itself, e.g. '(' or ';'
+  CHAR_SINGLE,
+  // '!', '=', '<' and '>': the token, or the type right after it in TokenType
+  // (BANG_EQUAL, EQUAL_EQUAL, ...) when followed by '='
+  CHAR_OPERATOR,
+  CHAR_SLASH,
+  CHAR_QUOTE,
+  CHAR_DIGIT,
+  CHAR_ALPHA,
+  // 0x80 and up, the first byte of a UTF-8 sequence or a stray one
+  CHAR_UTF8,
+};
+
+static const uint8_t parser_char_classes[256] = {
+    [' '] = CHAR_SPACE,     ['\t'] = CHAR_SPACE,     ['\r'] = CHAR_SPACE,
+    ['\n'] = CHAR_SPACE,    ['('] = CHAR_SINGLE,     [')'] = CHAR_SINGLE,
+    ['{'] = CHAR_SINGLE,    ['}'] = CHAR_SINGLE,     [','] = CHAR_SINGLE,
+    ['.'] = CHAR_SINGLE,    ['-'] = CHAR_SINGLE,     ['+'] = CHAR_SINGLE,
+    [';'] = CHAR_SINGLE,    ['*'] = CHAR_SINGLE,     ['!'] = CHAR_OPERATOR,
+    ['='] = CHAR_OPERATOR,  ['<'] = CHAR_OPERATOR,   ['>'] = CHAR_OPERATOR,
+    ['/'] = CHAR_SLASH,     ['"'] = CHAR_QUOTE,      ['0' ... '9'] = CHAR_DIGIT,
+    ['a' ... 'z'] = CHAR_ALPHA, ['A' ... 'Z'] = CHAR_ALPHA, ['_'] = CHAR_ALPHA,
+    [0x80 ... 0xFF] = CHAR_UTF8,
+};
+
+// token type for CHAR_SINGLE and CHAR_OPERATOR bytes
+static const uint8_t parser_char_tokens[256] = {
+    ['('] = LEFT_PAREN, [')'] = RIGHT_PAREN, ['{'] = LEFT_BRACE,
+    ['}'] = RIGHT_BRACE, [','] = COMMA,     ['.'] = DOT,
+    ['-'] = MINUS,       ['+'] = PLUS,      [';'] = SEMICOLON,
+    ['*'] = STAR,        ['!'] = BANG,      ['='] = EQUAL,
+    ['<'] = LESS,        ['>'] = GREATER,
+};
+
+_Static_assert(BANG_EQUAL == BANG + 1 && EQUAL_EQUAL == EQUAL + 1 &&
+                   LESS_EQUAL == LESS + 1 && GREATER_EQUAL == GREATER + 1,
+               "two-character operators must follow their one-character form");
+
+static inline uint8_t parser_char_class(char c) {
+  return parser_char_classes[(uint8_t)c];
 }
 
-static int is_alpha_numeric(char c) { return is_alpha(c) || is_digit(c); }
+static int is_digit(char c) { return parser_char_class(c) == CHAR_DIGIT; }
 
-struct parser_t *parser_create() {
+struct parser_t *parser_create(const struct allocator_t *allocator) {
   struct parser_t *parser =
-      (struct parser_t *)calloc(1, sizeof(struct parser_t));
+      (struct parser_t *)alloc_zeroed(allocator, sizeof(struct parser_t));
+
+  if (parser == NULL) {
+    LOG_ERROR("parser_create: error allocating memory for parser");
+    return NULL;
+  }
 
-  parser->tokens = arraylist_create(50);
-  parser->keywords = hashmap_create(64);
+  parser->allocator = allocator;
+  parser->tokens = token_stream_create(64, allocator);
+  parser->arena = arena_create(PARSER_ARENA_BLOCK_SIZE, allocator);
   parser->line = 1;
+  parser->final = 1;
 
-  hashmap_put(parser->keywords, "and", AND);
-  hashmap_put(parser->keywords, "class", CLASS);
-  hashmap_put(parser->keywords, "else", ELSE);
-  hashmap_put(parser->keywords, "false", FALSE);
-  hashmap_put(parser->keywords, "for", FOR);
-  hashmap_put(parser->keywords, "fun", FUN);
-  hashmap_put(parser->keywords, "if", IF);
-  hashmap_put(parser->keywords, "nil", NIL);
-  hashmap_put(parser->keywords, "or", OR);
-  hashmap_put(parser->keywords, "print", PRINT);
-  hashmap_put(parser->keywords, "return", RETURN);
-  hashmap_put(parser->keywords, "super", SUPER);
-  hashmap_put(parser->keywords, "this", THIS);
-  hashmap_put(parser->keywords, "true", TRUE);
-  hashmap_put(parser->keywords, "var", VAR);
-  hashmap_put(parser->keywords, "while", WHILE);
+  if (parser->tokens == NULL || parser->arena == NULL) {
+    LOG_ERROR("parser_create: error allocating memory for tokens");
+    parser_destroy(parser);
+    return NULL;
+  }
 
   return parser;
 }
 
-char parser_advance(struct parser_t *parser, char *file_contents) {
-  return file_contents[parser->current_idx++];
+// gives up on the scan: the rest of the buffer is skipped, so every loop
+// driving the scanner runs out of input and stops
+static void parser_out_of_memory(struct parser_t *parser) {
+  parser->out_of_memory = 1;
+  parser->error = 1;
+  parser->current_idx = parser->source_length;
+}
+
+// builds the line index for the current buffer if it isn't yet, returns 0 if
+// there's no memory for it
+static int parser_index_lines(struct parser_t *parser) {
+  const char *base = parser->source + parser->line_offset;
+  uint64_t length = parser->source_length - parser->line_offset;
+
+  if (!parser->lines_valid) {
+    if (parser->lines == NULL)
+      parser->lines = line_index_create(parser->allocator);
+
+    parser->lines_valid =
+        parser->lines != NULL && line_index_build(parser->lines, base, length);
+  }
+
+  return parser->lines_valid;
+}
+
+uint32_t parser_line(struct parser_t *parser, uint64_t offset) {
+  const char *base = parser->source + parser->line_offset;
+  uint64_t relative = offset - parser->line_offset;
+
+  parser_index_lines(parser);
+
+  // without memory for the index, counting still works
+  if (!parser->lines_valid)
+    return parser->line + (uint32_t)simd_count_newlines(base, relative);
+
+  return parser->line +
+         (uint32_t)line_index_line(parser->lines, relative) - 1;
+}
+
+uint64_t parser_column(struct parser_t *parser, uint64_t offset) {
+  const char *base = parser->source + parser->line_offset;
+  uint64_t relative = offset - parser->line_offset;
+
+  if (parser_index_lines(parser))
+    return line_index_column(parser->lines, base, relative);
+
+  // without the index, look back for the start of the line
+  uint64_t start = relative;
+
+  while (start > 0 && base[start - 1] != '\n')
+    start--;
+
+  return utf8_count_code_points(base + start, relative - start) + 1;
+}
+
+char parser_advance(struct parser_t *parser) {
+  return parser->source[parser->current_idx++];
+}
+
+// formats an error for parser->report, on the stack unless it's a long one
+static void parser_report_formatted(struct parser_t *parser,
+                                    const char *format, va_list args) {
+  char buffer[PARSER_REPORT_BUFFER_SIZE];
+  va_list copy;
+
+  va_copy(copy, args);
+  int length = vsnprintf(buffer, sizeof(buffer), format, copy);
+  va_end(copy);
+
+  if (length < 0)
+    return;
+
+  if ((size_t)length < sizeof(buffer)) {
+    parser->report(parser->report_context, buffer, (uint64_t)length);
+    return;
+  }
+
+  // counted like the rest of the parser's memory
+  uint64_t size = (uint64_t)length + 1;
+  char *text = (char *)alloc_allocate(parser->allocator, size);
+
+  if (text == NULL)
+    return;
+
+  vsnprintf(text, (size_t)size, format, args);
+  parser->report(parser->report_context, text, (uint64_t)length);
+  alloc_release(parser->allocator, text, size);
+}
+
+void parser_report_error(struct parser_t *parser, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+
+  if (parser->report != NULL)
+    parser_report_formatted(parser, format, args);
+  else if (parser->diagnostics != NULL)
+    diagnostics_vadd(parser->diagnostics, format, args);
+  else
+    vfprintf(stderr, format, args);
+
+  va_end(args);
+
+  parser->error = 1;
 }
 
 static void parser_add_data_token(struct parser_t *parser, TokenType token,
-                                  char *raw, void *data) {
+                                  union token_value_t value) {
+  struct token_stream_t *tokens = parser->tokens;
+  uint64_t offset = parser->start;
+  // the lexeme is whatever the scanner consumed since the token started
+  uint64_t length = parser->current_idx - parser->start;
+
+  // the stream keeps lengths in 32 bits, a lexeme past that is dropped
+  if (__builtin_expect(length > UINT32_MAX, 0)) {
+    LOG_INTERPRETER_ERROR(parser, "Token too long.");
+    return;
+  }
+
+  // token_stream_push is a call into another unit, only worth making when the
+  // columns have to grow
+  if (__builtin_expect(tokens->size == tokens->capacity, 0)) {
+    if (!token_stream_push(tokens, token, offset, length, value))
+      parser_out_of_memory(parser);
 
-  struct token_entry_t *entry = calloc(1, sizeof(struct token_entry_t));
+    return;
+  }
 
-  entry->data = data;
-  entry->raw = raw;
-  entry->type = token;
+  uint64_t index = tokens->size++;
 
-  arraylist_add(parser->tokens, (void *)entry);
+  tokens->types[index] = (uint8_t)token;
+  tokens->offsets[index] = offset;
+  tokens->lengths[index] = (uint32_t)length;
+  tokens->values[index] = value;
 }
 
 static void parser_add_token(struct parser_t *parser, TokenType token) {
-  parser_add_data_token(parser, token, NULL, NULL);
+  union token_value_t value = {0};
+  parser_add_data_token(parser, token, value);
+}
+
+int parser_at_file_end(struct parser_t *parser) {
+  return parser->current_idx >= parser->source_length;
 }
 
-int parser_at_file_end(struct parser_t *parser, char *file_contents) {
-  return file_contents[parser->current_idx] == '\0';
+// when feeding chunks, the end of the buffer isn't necessarily the end of the
+// input; a token that runs into it is incomplete and must be rescanned once
+// the next chunk arrives
+static int parser_truncated(struct parser_t *parser) {
+  if (!parser->final && parser_at_file_end(parser))
+    parser->need_more = 1;
+
+  return parser->need_more;
 }
 
-char parser_peek(struct parser_t *parser, char *file_contents) {
-  if (parser_at_file_end(parser, file_contents))
+char parser_peek(struct parser_t *parser) {
+  if (parser_at_file_end(parser))
     return '\0';
 
-  return file_contents[parser->current_idx];
+  return parser->source[parser->current_idx];
 }
 
-char parser_peek_next(struct parser_t *parser, char *file_contents) {
-  if (parser_at_file_end(parser, file_contents + 1))
+char parser_peek_next(struct parser_t *parser) {
+  if (parser->current_idx + 1 >= parser->source_length)
     return '\0';
 
-  return file_contents[parser->current_idx + 1];
+  return parser->source[parser->current_idx + 1];
 }
 
-void parser_string(struct parser_t *parser, char *file_contents) {
+// bytes left between the cursor and the end of the buffer
+static uint64_t parser_remaining(struct parser_t *parser) {
+  return parser->source_length - parser->current_idx;
+}
 
-  // until we reach another quotation mark, keep iterating
-  while (parser_peek(parser, file_contents) != '"' &&
-         !parser_at_file_end(parser, file_contents)) {
-    if (parser_peek(parser, file_contents) == '\n')
-      parser->line++;
+// the byte under the cursor, or '\0' past the end of the buffer
+static inline char parser_next_char(struct parser_t *parser) {
+  return parser->current_idx < parser->source_length
+             ? parser->source[parser->current_idx]
+             : '\0';
+}
 
-    parser_advance(parser, file_contents);
+// parser_match for the hot path: consumes the byte under the cursor if it's
+// desired, without a branch on the comparison
+static inline int parser_follows(struct parser_t *parser, char desired) {
+  if (parser->current_idx >= parser->source_length) {
+    // a chunk ending here can't tell "=" from "==" yet
+    parser_truncated(parser);
+    return 0;
+  }
+
+  int matched = parser->source[parser->current_idx] == desired;
+  parser->current_idx += matched;
+
+  return matched;
+}
+
+// length of the \u{...} escape at text[0, length), or 0 if it isn't one: 1
+// to 6 hex digits naming a Unicode scalar value
+static uint64_t parser_unicode_escape(const char *text, uint64_t length,
+                                      uint32_t *code_point) {
+  uint64_t i = 3;
+  uint32_t value = 0;
+
+  if (length < 4 || text[2] != '{')
+    return 0;
+
+  for (; i < length && i < 3 + 6; i++) {
+    char c = text[i];
+    char lower = (char)(c | 0x20);
+
+    if (c >= '0' && c <= '9')
+      value = value * 16 + (uint32_t)(c - '0');
+    else if (lower >= 'a' && lower <= 'f')
+      value = value * 16 + (uint32_t)(lower - 'a' + 10);
+    else
+      break;
+  }
+
+  if (i == 3 || i >= length || text[i] != '}' || value > 0x10FFFF ||
+      (value >= 0xD800 && value <= 0xDFFF))
+    return 0;
+
+  *code_point = value;
+
+  return i + 1;
+}
+
+// decodes the escapes in source[begin, end) into the arena, once. a bad
+// escape is reported and its backslash kept as written
+static const struct token_string_t *
+parser_decode_string(struct parser_t *parser, uint64_t begin, uint64_t end) {
+  const char *source = parser->source;
+  // an escape is never shorter than what it stands for, so the decoded text
+  // fits in the space of the escaped one
+  struct token_string_t *decoded = (struct token_string_t *)arena_alloc(
+      parser->arena, sizeof(struct token_string_t) + (end - begin) + 1);
+
+  if (decoded == NULL)
+    return NULL;
+
+  char *out = decoded->text;
+  uint64_t i = begin;
+
+  while (i < end) {
+    // everything up to the next backslash goes over as is
+    const char *backslash =
+        (const char *)memchr(source + i, '\\', end - i);
+    uint64_t plain = backslash != NULL ? (uint64_t)(backslash - source) - i
+                                       : end - i;
+
+    memcpy(out, source + i, plain);
+    out += plain;
+    i += plain;
+
+    if (i == end)
+      break;
+
+    uint32_t code_point;
+    uint64_t used = 2;
+
+    switch (i + 1 < end ? source[i + 1] : '\0') {
+    case 'n':
+      *out++ = '\n';
+      break;
+    case 't':
+      *out++ = '\t';
+      break;
+    case '"':
+      *out++ = '"';
+      break;
+    case '\\':
+      *out++ = '\\';
+      break;
+    case 'u':
+      used = parser_unicode_escape(source + i, end - i, &code_point);
+
+      if (used != 0) {
+        out += utf8_encode(code_point, out);
+        break;
+      }
+
+      LOG_INTERPRETER_ERROR(parser, "Invalid Unicode escape.");
+      *out++ = '\\';
+      used = 1;
+      break;
+    default:
+      LOG_INTERPRETER_ERROR(parser, "Invalid escape sequence.");
+      *out++ = '\\';
+      used = 1;
+      break;
+    }
+
+    i += used;
+  }
+
+  decoded->length = (uint64_t)(out - decoded->text);
+  decoded->text[decoded->length] = '\0';
+
+  return decoded;
+}
+
+void parser_string(struct parser_t *parser) {
+  int malformed = 0;
+  int escaped = 0;
+
+  // jump to the next quotation mark (or the end). the kernel also stops at
+  // backslashes and non-ASCII bytes, which are stepped over here
+  for (;;) {
+    parser->current_idx += simd_find_string_end(
+        parser->source + parser->current_idx, parser_remaining(parser));
+
+    char c = parser_next_char(parser);
+
+    if (c == '\\') {
+      // the byte after it can't end the literal (or start another escape).
+      // one from 0x80 up is left for the UTF-8 check below
+      escaped = 1;
+      parser->current_idx += 1 + ((uint8_t)parser_peek_next(parser) < 0x80);
+
+      if (parser->current_idx > parser->source_length)
+        parser->current_idx = parser->source_length;
+
+      continue;
+    }
+
+    if ((uint8_t)c < 0x80)
+      break;
+
+    uint32_t code_point;
+    uint32_t size = utf8_decode(parser->source + parser->current_idx,
+                                parser_remaining(parser), &code_point);
+
+    // a sequence cut off by the chunk end goes back with the whole literal,
+    // so counting it as malformed here never sticks
+    if (size == 0 || size == UTF8_INCOMPLETE) {
+      malformed = 1;
+      size = 1;
+    }
+
+    parser->current_idx += size;
   }
 
-  if (parser_at_file_end(parser, file_contents)) {
+  if (parser_truncated(parser))
+    return;
+
+  if (parser_at_file_end(parser)) {
     // reached end of file before quotation finished
     LOG_INTERPRETER_ERROR(parser, "Unterminated string.");
     return;
   }
 
-  parser_advance(parser, file_contents); // get rid of last quotation mark
+  parser_advance(parser); // get rid of last quotation mark
 
-  // get substring
+  // still a token, the bad bytes just get reported. a literal carried in by
+  // the parallel scan is only checked from the chunk start, see there
+  if (malformed)
+    LOG_INTERPRETER_ERROR(parser, "Invalid UTF-8 in string.");
 
-  int str_len = parser->current_idx - parser->start - 2;
-  char *parsed_str = (char *)calloc(str_len, sizeof(char));
+  // without escapes the literal is the lexeme minus its quotes, so there's
+  // nothing to copy
+  const char *literal = parser->source + parser->start + 1;
+  uint64_t length = parser->current_idx - parser->start - 2;
+  const struct token_string_t *decoded = NULL;
+  union token_value_t value = {0};
 
-  strncpy(parsed_str, file_contents + parser->start + 1, str_len);
+  if (escaped) {
+    decoded = parser_decode_string(parser, parser->start + 1,
+                                   parser->current_idx - 1);
 
-  // NOTE: could add escape sequences here in the future
-  parser_add_data_token(parser, STRING, parsed_str, (void *)parsed_str);
+    if (decoded == NULL) {
+      parser_out_of_memory(parser);
+      return;
+    }
+
+    literal = decoded->text;
+    length = decoded->length;
+  }
+
+  // the value holds one or the other: with an interner the decoded copy was
+  // only needed to intern it
+  if (parser->interner != NULL) {
+    value.symbol = interner_intern(parser->interner, literal, length);
+
+    if (value.symbol == INTERN_NO_SYMBOL) {
+      parser_out_of_memory(parser);
+      return;
+    }
+  } else {
+    value.string = decoded;
+  }
+
+  parser_add_data_token(parser, STRING, value);
 }
 
-int parser_match(struct parser_t *parser, char *file_contents, char desired) {
-  if (parser_at_file_end(parser, file_contents))
+int parser_match(struct parser_t *parser, char desired) {
+  if (parser_at_file_end(parser)) {
+    parser_truncated(parser);
     return 0;
-  if (file_contents[parser->current_idx] != desired)
+  }
+  if (parser->source[parser->current_idx] != desired)
     return 0;
 
   parser->current_idx++;
@@ -116,156 +501,352 @@ int parser_match(struct parser_t *parser, char *file_contents, char desired) {
   return 1;
 }
 
-void parser_number(struct parser_t *parser, char *file_contents) {
+void parser_number(struct parser_t *parser) {
   // go through the entire number
-  while (is_digit(parser_peek(parser, file_contents)))
-    parser_advance(parser, file_contents);
+  parser->current_idx += simd_digit_run(parser->source + parser->current_idx,
+                                        parser_remaining(parser));
 
   // number might be a decimal, if found discard and keep advancing
-  if (parser_peek(parser, file_contents) == '.' &&
-      is_digit(parser_peek_next(parser, file_contents))) {
-    parser_advance(parser, file_contents); // discard .
+  if (parser_next_char(parser) == '.' && is_digit(parser_peek_next(parser))) {
+    parser_advance(parser); // discard .
+
+    parser->current_idx += simd_digit_run(
+        parser->source + parser->current_idx, parser_remaining(parser));
+  } else if (!parser->final && parser_next_char(parser) == '.' &&
+             parser->current_idx + 1 >= parser->source_length) {
+    // can't tell "1." from "1.5" until the next chunk shows up
+    parser->need_more = 1;
+  }
+
+  if (parser_truncated(parser))
+    return;
+
+  // converted straight from the source span and stored inline in the token
+  union token_value_t value = {
+      .number = number_parse(parser->source + parser->start,
+                             parser->current_idx - parser->start)};
+
+  parser_add_data_token(parser, NUMBER, value);
+}
+
+void parser_identifier(struct parser_t *parser) {
+  // ASCII a vector at a time, dropping to the decoder only at a byte that
+  // could start an XID_Continue code point
+  for (;;) {
+    parser->current_idx += simd_identifier_run(
+        parser->source + parser->current_idx, parser_remaining(parser));
+
+    if ((uint8_t)parser_next_char(parser) < 0x80)
+      break;
+
+    uint32_t code_point;
+    uint32_t size = utf8_decode(parser->source + parser->current_idx,
+                                parser_remaining(parser), &code_point);
 
-    while (is_digit(parser_peek(parser, file_contents)))
-      parser_advance(parser, file_contents);
+    if (size == UTF8_INCOMPLETE && !parser->final) {
+      // the rest of the sequence decides whether the name goes on
+      parser->need_more = 1;
+      return;
+    }
+
+    if (size == 0 || size == UTF8_INCOMPLETE ||
+        !utf8_is_xid_continue(code_point))
+      break;
+
+    parser->current_idx += size;
   }
 
-  int str_len = parser->current_idx - parser->start;
-  char *parsed_str = (char *)calloc(str_len, sizeof(char));
+  if (parser_truncated(parser))
+    return;
 
-  strncpy(parsed_str, file_contents + parser->start, str_len);
+  // check for reserved keyword straight off the source span
+  const char *lexeme = parser->source + parser->start;
+  uint64_t length = parser->current_idx - parser->start;
+  TokenType type = keyword_lookup(lexeme, length);
+  union token_value_t value = {0};
 
-  double num = atof(parsed_str);
+  if (type == IDENTIFIER && parser->interner != NULL) {
+    value.symbol = interner_intern(parser->interner, lexeme, length);
 
-  // TODO: Find if there's a way to avoid having to move this to the heap
-  double *num_heap = (double *)malloc(sizeof(double));
-  *num_heap = num;
+    if (value.symbol == INTERN_NO_SYMBOL) {
+      parser_out_of_memory(parser);
+      return;
+    }
+  }
 
-  parser_add_data_token(parser, NUMBER, parsed_str, (void *)num_heap);
+  parser_add_data_token(parser, type, value);
 }
 
-void parser_identifier(struct parser_t *parser, char *file_contents) {
-  while (is_alpha_numeric(parser_peek(parser, file_contents))) {
-    parser_advance(parser, file_contents);
-  }
+// a byte from 0x80 up starts a non-ASCII identifier, some character lox has
+// no use for or a stretch of malformed UTF-8, which is reported once
+static void parser_non_ascii(struct parser_t *parser) {
+  const char *data = parser->source + parser->start;
+  uint64_t available = parser->source_length - parser->start;
+  uint32_t code_point;
+  uint32_t size = utf8_decode(data, available, &code_point);
 
-  // retrieve string
-  int str_len = parser->current_idx - parser->start;
-  char *parsed_str = (char *)calloc(str_len, sizeof(char));
+  if (size == 0 || size == UTF8_INCOMPLETE) {
+    parser->current_idx = parser->start + utf8_invalid_run(data, available);
 
-  strncpy(parsed_str, file_contents + parser->start, str_len);
+    // a sequence cut off by the chunk end may still complete
+    if (parser_truncated(parser))
+      return;
+
+    LOG_INTERPRETER_ERROR(parser, "Invalid UTF-8 sequence.");
+    return;
+  }
 
-  // check fo rreserved keyword
-  TokenType type = hashmap_lookup(parser->keywords, parsed_str);
+  parser->current_idx = parser->start + size;
 
-  // TODO: reserved
-  parser_add_data_token(parser, type, parsed_str, parsed_str);
+  if (utf8_is_xid_start(code_point)) {
+    parser_identifier(parser);
+    return;
+  }
+
+  LOG_INTERPRETER_ERROR(parser, "Unexpected character: %.*s", (int)size,
+                        data);
 }
 
-void parser_scan_token(struct parser_t *parser, char *file_contents) {
-  char c = parser_advance(parser, file_contents);
+static void parser_skip_comment(struct parser_t *parser) {
+  parser->current_idx += simd_find_line_end(
+      parser->source + parser->current_idx, parser_remaining(parser));
 
-  switch (c) {
-  case ' ':
-  case '\r':
-  case '\t':
-    break;
+  // nothing in a comment becomes a token, so rather than holding on to it
+  // just remember to keep skipping at the start of the next chunk
+  parser->in_comment = parser_at_file_end(parser) && !parser->final;
+}
+
+static inline __attribute__((always_inline)) void
+parser_scan_next(struct parser_t *parser) {
+  char c = parser->source[parser->current_idx++];
+
+  // the classes are dense from 0, so this compiles to a jump table
+  switch (parser_char_class(c)) {
+  case CHAR_SPACE:
+    // single separators are the common case, only hand longer runs (e.g.
+    // indentation) to the vector kernel
+    if (parser_char_class(parser_next_char(parser)) == CHAR_SPACE) {
+      parser->current_idx += simd_whitespace_run(
+          parser->source + parser->current_idx, parser_remaining(parser));
+    }
 
-  case '\n':
-    parser->line++;
-    break;
-  case '(':
-    parser_add_token(parser, LEFT_PAREN);
-    break;
-  case ')':
-    parser_add_token(parser, RIGHT_PAREN);
-    break;
-  case '{':
-    parser_add_token(parser, LEFT_BRACE);
-    break;
-  case '}':
-    parser_add_token(parser, RIGHT_BRACE);
-    break;
-  case ',':
-    parser_add_token(parser, COMMA);
-    break;
-  case '.':
-    parser_add_token(parser, DOT);
-    break;
-  case '-':
-    parser_add_token(parser, MINUS);
-    break;
-  case '+':
-    parser_add_token(parser, PLUS);
-    break;
-  case ';':
-    parser_add_token(parser, SEMICOLON);
-    break;
-  case '*':
-    parser_add_token(parser, STAR);
-    break;
-  case '!':
-    parser_add_token(
-        parser, parser_match(parser, file_contents, '=') ? BANG_EQUAL : BANG);
-    break;
-  case '=':
-    parser_add_token(
-        parser, parser_match(parser, file_contents, '=') ? EQUAL_EQUAL : EQUAL);
     break;
-  case '>':
-    parser_add_token(parser, parser_match(parser, file_contents, '=')
-                                 ? GREATER_EQUAL
-                                 : GREATER);
+  case CHAR_SINGLE:
+    parser_add_token(parser, (TokenType)parser_char_tokens[(uint8_t)c]);
     break;
-  case '<':
-    parser_add_token(
-        parser, (parser_match(parser, file_contents, '=') ? LESS_EQUAL : LESS));
+  case CHAR_OPERATOR:
+    parser_add_token(parser, (TokenType)(parser_char_tokens[(uint8_t)c] +
+                                         parser_follows(parser, '=')));
     break;
-  case '/':
-    if (parser_match(parser, file_contents, '/')) {
+  case CHAR_SLASH:
+    if (parser_follows(parser, '/')) {
       // detected comment, keep going
-      while (parser_peek(parser, file_contents) != '\n' &&
-             !parser_at_file_end(parser, file_contents))
-        parser_advance(parser, file_contents);
+      parser_skip_comment(parser);
     } else {
       parser_add_token(parser, SLASH);
     }
 
     break;
-
-  case '"':
-    parser_string(parser, file_contents);
+  case CHAR_QUOTE:
+    parser_string(parser);
+    break;
+  case CHAR_DIGIT:
+    parser_number(parser);
+    break;
+  case CHAR_ALPHA:
+    parser_identifier(parser);
+    break;
+  case CHAR_UTF8:
+    parser_non_ascii(parser);
     break;
-
   default:
-    // check if we're dealing with a number
-    if (is_digit(c)) {
-      parser_number(parser, file_contents);
-      return;
-    }
-    if (is_alpha(c)) {
-      // check for keyword
-      parser_identifier(parser, file_contents);
-      return;
-    }
-
     // syntax error
     LOG_INTERPRETER_ERROR(parser, "Unexpected character: %c", c);
     break;
   }
 }
 
-struct arraylist_t *parser_get_tokens(struct parser_t *parser) {
+void parser_scan_token(struct parser_t *parser) { parser_scan_next(parser); }
+
+struct token_stream_t *parser_get_tokens(struct parser_t *parser) {
   return parser->tokens;
 }
 
-void parser_parse(struct parser_t *parser, char *contents) {
-  if (strlen(contents) > 0) {
-    while (!parser_at_file_end(parser, contents)) {
-      parser->start = parser->current_idx;
-      parser_scan_token(parser, contents);
+uint64_t parser_scan_range(struct parser_t *parser, const char *source,
+                           uint64_t begin, uint64_t end, int final) {
+  parser->source = source;
+  parser->source_length = end;
+  parser->current_idx = begin;
+  parser->final = final;
+  parser->need_more = 0;
+  parser->line_offset = begin;
+  parser->lines_valid = 0;
+
+  if (parser->in_comment)
+    parser_skip_comment(parser);
+
+  int resume_string = parser->in_string;
+  parser->in_string = 0;
+
+  while (!parser_at_file_end(parser)) {
+    parser->start = parser->current_idx;
+
+    uint64_t token_count = parser->tokens->size;
+
+    if (resume_string) {
+      // the opening quote is behind us, scan for the closing one
+      resume_string = 0;
+      parser_string(parser);
+    } else {
+      parser_scan_next(parser);
+    }
+
+    if (parser->need_more) {
+      // undo everything the partial token did, the caller hands its bytes
+      // back to us at the front of the next chunk
+      parser->current_idx = parser->start;
+      token_stream_truncate(parser->tokens, token_count);
+      parser->need_more = 0;
+      break;
     }
   }
 
-  parser_add_token(parser, END_OF_FILE);
+  if (final) {
+    parser->start = parser->current_idx;
+    parser_add_token(parser, END_OF_FILE);
+  } else {
+    // the next chunk starts where this one stopped, carry the line over. the
+    // index is only used if a diagnostic already built it, a clean chunk
+    // just counts
+    uint64_t relative = parser->current_idx - parser->line_offset;
+
+    if (parser->lines_valid) {
+      parser->line += (uint32_t)line_index_line(parser->lines, relative) - 1;
+    } else {
+      parser->line += (uint32_t)simd_count_newlines(
+          parser->source + parser->line_offset, relative);
+    }
+
+    parser->line_offset = parser->current_idx;
+    parser->lines_valid = 0;
+  }
+
+  return parser->current_idx;
+}
+
+uint64_t parser_feed(struct parser_t *parser, const char *chunk,
+                     uint64_t length, int final) {
+  return parser_scan_range(parser, chunk, 0, length, final);
+}
+
+// scans until the stream holds wanted tokens or EOF has been added. a whole
+// buffer is scanned in one go, so there's no partial token to look out for
+static void parser_pull(struct parser_t *parser, uint64_t wanted) {
+  while (parser->tokens->size < wanted && !parser->pulled_eof) {
+    parser->start = parser->current_idx;
+
+    if (parser_at_file_end(parser)) {
+      parser_add_token(parser, END_OF_FILE);
+      parser->pulled_eof = 1;
+      break;
+    }
+
+    parser_scan_next(parser);
+  }
+}
+
+void parser_begin(struct parser_t *parser, const char *contents,
+                  uint64_t length) {
+  // the length is authoritative, the buffer doesn't need a terminator and may
+  // contain NUL bytes
+  parser->source = contents;
+  parser->source_length = length;
+  parser->current_idx = 0;
+  parser->final = 1;
+  parser->need_more = 0;
+  parser->in_comment = 0;
+  parser->in_string = 0;
+  parser->line_offset = 0;
+  parser->lines_valid = 0;
+  parser->next_token = parser->tokens->size;
+  parser->pulled_eof = 0;
+}
+
+int parser_peek_token(struct parser_t *parser, uint64_t k,
+                      struct token_entry_t *entry) {
+  struct token_stream_t *tokens = parser->tokens;
+
+  // make room by dropping what's been handed out rather than growing
+  if (parser->next_token > 0 && tokens->size == tokens->capacity) {
+    token_stream_drop_front(tokens, parser->next_token);
+    parser->next_token = 0;
+  }
+
+  parser_pull(parser, parser->next_token + k + 1);
+
+  if (parser->next_token + k >= tokens->size)
+    return 0;
+
+  *entry = token_stream_get(tokens, parser->next_token + k);
+
+  return 1;
+}
+
+int parser_next_token(struct parser_t *parser, struct token_entry_t *entry) {
+  if (!parser_peek_token(parser, 0, entry))
+    return 0;
+
+  // once everything scanned has been handed out, start the stream over
+  if (++parser->next_token == parser->tokens->size) {
+    token_stream_clear(parser->tokens);
+    parser->next_token = 0;
+  }
+
+  return 1;
+}
+
+void parser_parse(struct parser_t *parser, const char *contents,
+                  uint64_t length) {
+  // whole-list mode is pull mode with nobody taking tokens out. a failed
+  // reserve isn't fatal, the stream still grows as it goes
+  token_stream_reserve(parser->tokens, parser->tokens->size +
+                                           length / PARSER_BYTES_PER_TOKEN + 1);
+  parser_begin(parser, contents, length);
+  parser_pull(parser, UINT64_MAX);
+}
+
+void parser_reset(struct parser_t *parser) {
+  // tokens are plain records in the stream and any payloads live in the
+  // arena, so rewinding both releases everything at once
+  token_stream_clear(parser->tokens);
+  arena_reset(parser->arena);
+
+  parser->line = 1;
+  parser->line_offset = 0;
+  parser->lines_valid = 0;
+  parser->error = 0;
+  parser->out_of_memory = 0;
+  parser->start = 0;
+  parser->current_idx = 0;
+  parser->source = NULL;
+  parser->source_length = 0;
+  parser->final = 1;
+  parser->in_comment = 0;
+  parser->need_more = 0;
+  parser->in_string = 0;
+  parser->next_token = 0;
+  parser->pulled_eof = 0;
+}
+
+void parser_destroy(struct parser_t *parser) {
+  if (parser->tokens != NULL)
+    token_stream_destroy(parser->tokens);
+
+  if (parser->arena != NULL)
+    arena_destroy(parser->arena);
+
+  if (parser->lines != NULL)
+    line_index_destroy(parser->lines);
+
+  alloc_release(parser->allocator, parser, sizeof(struct parser_t));
 }
@@ -1,50 +1,147 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-#include "arraylist.h"
+#include "alloc.h"
+#include "arena.h"
+#include "diagnostics.h"
+#include "intern.h"
+#include "line_index.h"
 #include "token.h"
-#include "token_keyword_table.h"
+#include "token_stream.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define LOG_INTERPRETER_ERROR(parser, msg, ...)                                \
-  fprintf(stderr, "[line %d] Error: " msg "\n", parser->line, ##__VA_ARGS__);  \
-  parser->error = 1
+  parser_report_error(parser, "[line %u] Error: " msg "\n",                  \
+                      parser_line(parser, parser->current_idx), ##__VA_ARGS__)
 
 struct parser_t {
-  struct arraylist_t *tokens;
-  struct token_keyword_table *keywords;
+  struct token_stream_t *tokens;
+  // owns token payloads that can't be expressed as a span of the source
+  struct arena_t *arena;
+  // line number of source[line_offset]. the scanner never counts newlines
+  // itself, parser_line works lines out from here when they're needed
   uint32_t line;
+  uint64_t line_offset;
+  // newline index of source from line_offset on, built on the first
+  // parser_line call for the current buffer
+  struct line_index_t *lines;
+  uint8_t lines_valid;
   uint8_t error;
-  uint32_t start;
-  uint32_t current_idx;
+  // a token or symbol couldn't be stored, set along with error. scanning
+  // stops there, so the tokens are incomplete and shouldn't be used
+  uint8_t out_of_memory;
+  // where the parser and everything it owns get memory from, NULL for malloc
+  const struct allocator_t *allocator;
+  // buffer being scanned, not owned by the parser
+  const char *source;
+  uint64_t source_length;
+  uint64_t start;
+  uint64_t current_idx;
+  // set when the end of source is the end of the input, cleared while
+  // feeding chunks
+  uint8_t final;
+  // a // comment ran off the end of the previous chunk
+  uint8_t in_comment;
+  // the token being scanned ran off the end of a non-final chunk
+  uint8_t need_more;
+  // the next scan starts inside a string literal that was opened before it,
+  // set by callers that split the input themselves
+  uint8_t in_string;
+  // when set, errors are collected here instead of going to stderr. not owned
+  // by the parser
+  struct diagnostics_t *diagnostics;
+  // when set, every error (formatted, newline included) goes here instead of
+  // to diagnostics or stderr
+  void (*report)(void *context, const char *text, uint64_t length);
+  void *report_context;
+  // when set, identifiers and string literals carry a symbol from here in
+  // their value (strings without their quotes, escapes decoded). not owned
+  // by the parser
+  struct interner_t *interner;
+  // pull mode: index of the next token to hand out, and whether EOF has been
+  // scanned
+  uint64_t next_token;
+  uint8_t pulled_eof;
 };
 
-struct parser_t *parser_create();
+// returns NULL when out of memory
+struct parser_t *parser_create(const struct allocator_t *allocator);
 
-char parser_advance(struct parser_t *parser, char *file_contents);
+char parser_advance(struct parser_t *parser);
+
+// line number of source[offset], offset being at or past line_offset
+uint32_t parser_line(struct parser_t *parser, uint64_t offset);
+
+// 1-based column of source[offset], counted in code points. only right when
+// the buffer at line_offset starts a line, as a whole-buffer scan's does
+uint64_t parser_column(struct parser_t *parser, uint64_t offset);
+
+// flags the parse as failed and prints (or collects) the message
+__attribute__((format(printf, 2, 3))) void
+parser_report_error(struct parser_t *parser, const char *format, ...);
 
 static void parser_add_data_token(struct parser_t *parser, TokenType token,
-                                  char *raw, void *data);
+                                  union token_value_t value);
 
 static void parser_add_token(struct parser_t *parser, TokenType token);
 
-int parser_at_file_end(struct parser_t *parser, char *file_contents);
+int parser_at_file_end(struct parser_t *parser);
+
+char parser_peek(struct parser_t *parser);
+
+char parser_peek_next(struct parser_t *parser);
+
+void parser_string(struct parser_t *parser);
+
+int parser_match(struct parser_t *parser, char desired);
+
+void parser_number(struct parser_t *parser);
+
+void parser_identifier(struct parser_t *parser);
+
+// scans the whole of contents, same as pulling every token but keeping them
+// all in the stream
+void parser_parse(struct parser_t *parser, const char *contents,
+                  uint64_t length);
 
-char parser_peek(struct parser_t *parser, char *file_contents);
+// starts pull mode over contents[0, length): nothing is scanned until tokens
+// are asked for, and the stream only ever holds the ones not yet handed out,
+// so memory is bounded by the lookahead rather than the input
+void parser_begin(struct parser_t *parser, const char *contents,
+                  uint64_t length);
 
-char parser_peek_next(struct parser_t *parser, char *file_contents);
+// the token k places after the next one (0 being the next one itself),
+// scanning as far as needed. returns 0 if the input ends first
+int parser_peek_token(struct parser_t *parser, uint64_t k,
+                      struct token_entry_t *entry);
 
-void parser_string(struct parser_t *parser, char *file_contents);
+// hands out the next token, EOF last. returns 0 once EOF has been handed
+// out; parser->error tells whether anything so far was invalid, so callers
+// can stop at the first error
+int parser_next_token(struct parser_t *parser, struct token_entry_t *entry);
 
-int parser_match(struct parser_t *parser, char *file_contents, char desired);
+void parser_scan_token(struct parser_t *parser);
 
-void parser_number(struct parser_t *parser, char *file_contents);
+// scans one chunk of a larger input. tokens are appended with offsets relative
+// to the chunk; returns how many bytes were consumed, the rest belong to an
+// incomplete token and must be passed again at the start of the next chunk
+uint64_t parser_feed(struct parser_t *parser, const char *chunk,
+                     uint64_t length, int final);
 
-void parser_identifier(struct parser_t *parser, char *file_contents);
+// scans source[begin, end) of a buffer split at line boundaries, token offsets
+// are relative to source itself. with in_string set, the scan picks up inside
+// a string literal and its first token is that STRING, spanning from begin.
+// returns where scanning stopped, like parser_feed
+uint64_t parser_scan_range(struct parser_t *parser, const char *source,
+                           uint64_t begin, uint64_t end, int final);
 
-void parser_parse(struct parser_t *parser, char *contents);
+struct token_stream_t *parser_get_tokens(struct parser_t *parser);
 
-void parser_scan_token(struct parser_t *parser, char *file_contents);
+void parser_reset(struct parser_t *parser);
 
-struct arraylist_t *parser_get_tokens(struct parser_t *parser);
+void parser_destroy(struct parser_t *parser);
 
 #endif // PARSER_H
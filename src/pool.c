@@ -0,0 +1,154 @@
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+
+// front of the worker's own queue. returns 0 when it's empty
+static int pool_take(struct pool_queue_t *queue, uint64_t *task) {
+  pthread_mutex_lock(&queue->lock);
+
+  int found = queue->head < queue->tail;
+
+  if (found)
+    *task = queue->tasks[queue->head++];
+
+  pthread_mutex_unlock(&queue->lock);
+
+  return found;
+}
+
+// back of someone else's queue, the task its owner would get to last
+static int pool_steal(struct pool_queue_t *queue, uint64_t *task) {
+  pthread_mutex_lock(&queue->lock);
+
+  int found = queue->head < queue->tail;
+
+  if (found)
+    *task = queue->tasks[--queue->tail];
+
+  pthread_mutex_unlock(&queue->lock);
+
+  return found;
+}
+
+static void *pool_work(void *argument) {
+  struct pool_worker_t *worker = (struct pool_worker_t *)argument;
+  struct pool_t *pool = worker->pool;
+  uint64_t task;
+
+  for (;;) {
+    if (pool_take(&pool->queues[worker->index], &task)) {
+      pool->task(pool->context, worker->index, task);
+      continue;
+    }
+
+    // nothing is ever queued after the start, so one sweep that finds every
+    // queue empty means this worker is done
+    int stole = 0;
+
+    for (uint32_t i = 1; i < pool->worker_count && !stole; i++) {
+      uint32_t victim = (worker->index + i) % pool->worker_count;
+      stole = pool_steal(&pool->queues[victim], &task);
+    }
+
+    if (!stole)
+      return NULL;
+
+    pool->task(pool->context, worker->index, task);
+  }
+}
+
+struct pool_t *pool_create(uint32_t workers, uint64_t tasks, pool_task_t task,
+                           void *context) {
+  if (workers == 0) {
+    LOG_ERROR("pool_create: cannot have 0 workers, must be > 0");
+    return NULL;
+  }
+
+  struct pool_t *pool = (struct pool_t *)calloc(1, sizeof(struct pool_t));
+
+  if (pool == NULL) {
+    LOG_ERROR("pool_create: error allocating memory for pool");
+    return NULL;
+  }
+
+  pool->worker_count = workers;
+  pool->task = task;
+  pool->context = context;
+  pool->workers =
+      (struct pool_worker_t *)calloc(workers, sizeof(struct pool_worker_t));
+  pool->queues =
+      (struct pool_queue_t *)calloc(workers, sizeof(struct pool_queue_t));
+
+  if (pool->workers == NULL || pool->queues == NULL) {
+    LOG_ERROR("pool_create: error allocating memory for workers");
+    free(pool->workers);
+    free(pool->queues);
+    free(pool);
+    return NULL;
+  }
+
+  uint64_t per_worker = tasks / workers + 1;
+
+  for (uint32_t i = 0; i < workers; i++) {
+    struct pool_queue_t *queue = &pool->queues[i];
+
+    pthread_mutex_init(&queue->lock, NULL);
+    queue->tasks = (uint64_t *)malloc(per_worker * sizeof(uint64_t));
+
+    if (queue->tasks == NULL) {
+      LOG_ERROR("pool_create: error allocating memory for task queue");
+      pool->worker_count = i + 1;
+      pool_destroy(pool);
+      return NULL;
+    }
+  }
+
+  // dealt round-robin so every worker starts near the front of the list
+  for (uint64_t t = 0; t < tasks; t++) {
+    struct pool_queue_t *queue = &pool->queues[t % workers];
+    queue->tasks[queue->tail++] = t;
+  }
+
+  for (uint32_t i = 0; i < workers; i++) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i;
+    pool->workers[i].started =
+        pthread_create(&pool->workers[i].thread, NULL, pool_work,
+                       &pool->workers[i]) == 0;
+  }
+
+  // the others steal whatever a worker that failed to start left behind; with
+  // none running at all, the caller's thread has to do it
+  int any_started = 0;
+
+  for (uint32_t i = 0; i < workers; i++)
+    any_started |= pool->workers[i].started;
+
+  if (!any_started)
+    pool_work(&pool->workers[0]);
+
+  return pool;
+}
+
+void pool_destroy(struct pool_t *pool) {
+  if (pool == NULL) {
+    LOG_ERROR("pool_destroy: null pool provided");
+    return;
+  }
+
+  for (uint32_t i = 0; i < pool->worker_count; i++) {
+    if (pool->workers[i].started)
+      pthread_join(pool->workers[i].thread, NULL);
+  }
+
+  for (uint32_t i = 0; i < pool->worker_count; i++) {
+    pthread_mutex_destroy(&pool->queues[i].lock);
+    free(pool->queues[i].tasks);
+  }
+
+  free(pool->workers);
+  free(pool->queues);
+  free(pool);
+}
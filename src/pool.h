@@ -0,0 +1,45 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+// runs one call per task index on a fixed set of worker threads. tasks are
+// dealt round-robin into per-worker queues up front; a worker takes its own
+// tasks lowest index first and, once out of work, steals the highest index
+// left on another worker's queue. so everything finishes roughly in index
+// order however uneven the tasks are
+typedef void (*pool_task_t)(void *context, uint32_t worker, uint64_t task);
+
+struct pool_queue_t {
+  pthread_mutex_t lock;
+  uint64_t *tasks;
+  uint64_t head;
+  uint64_t tail;
+};
+
+struct pool_worker_t {
+  struct pool_t *pool;
+  uint32_t index;
+  pthread_t thread;
+  uint8_t started;
+};
+
+struct pool_t {
+  uint32_t worker_count;
+  struct pool_worker_t *workers;
+  struct pool_queue_t *queues;
+  pool_task_t task;
+  void *context;
+};
+
+// starts the workers right away, every task has run once pool_destroy returns.
+// a worker index is only ever used by one thread at a time, so it can pick
+// per-worker state out of the context
+struct pool_t *pool_create(uint32_t workers, uint64_t tasks, pool_task_t task,
+                           void *context);
+
+// waits for every task to finish, then frees the pool
+void pool_destroy(struct pool_t *pool);
+
+#endif // POOL_H
@@ -0,0 +1,138 @@
+#include "relex.h"
+#include "log.h"
+#include "token_stream.h"
+#include <stdio.h>
+
+// how far past its end a token's bytes can still decide it: a number looks at
+// the '.' after it and the digit after that, an identifier at a whole UTF-8
+// sequence that might continue it
+#define RELEX_LOOKAHEAD 4
+
+// how many leading tokens can't have been affected by an edit at offset. the
+// scanner only ever stops at a token boundary, so the end of the last of them
+// is a point where it can safely start over
+static uint64_t relex_stable_prefix(const struct token_stream_t *tokens,
+                                    uint64_t count, uint64_t offset) {
+  uint64_t low = 0;
+  uint64_t high = count;
+
+  // tokens don't overlap, so their ends are sorted like their offsets
+  while (low < high) {
+    uint64_t mid = low + (high - low) / 2;
+
+    if (tokens->offsets[mid] + tokens->lengths[mid] + RELEX_LOOKAHEAD <= offset)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+// index of the first token starting at or after offset
+static uint64_t relex_first_from(const struct token_stream_t *tokens,
+                                 uint64_t count, uint64_t offset) {
+  uint64_t low = 0;
+  uint64_t high = count;
+
+  while (low < high) {
+    uint64_t mid = low + (high - low) / 2;
+
+    if (tokens->offsets[mid] < offset)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+int relex_apply(struct parser_t *parser, const char *source, uint64_t length,
+                const struct relex_edit_t *edit,
+                struct relex_range_t *changed) {
+  struct token_stream_t *tokens = parser->tokens;
+  uint64_t count = tokens->size;
+
+  if (count == 0 || tokens->types[count - 1] != END_OF_FILE) {
+    LOG_ERROR("relex_apply: token stream isn't a complete scan");
+    return 0;
+  }
+
+  // the EOF token sits at the very end of the old text
+  uint64_t old_length = tokens->offsets[count - 1];
+  uint64_t edit_end = edit->offset + edit->removed_length;
+
+  if (edit_end > old_length ||
+      old_length - edit->removed_length + edit->inserted_length != length) {
+    LOG_ERROR("relex_apply: edit doesn't match the source");
+    return 0;
+  }
+
+  struct token_stream_t *scanned = token_stream_create(16, parser->allocator);
+
+  if (scanned == NULL)
+    return 0;
+
+  uint64_t first = relex_stable_prefix(tokens, count - 1, edit->offset);
+  uint64_t restart =
+      first > 0 ? tokens->offsets[first - 1] + tokens->lengths[first - 1] : 0;
+
+  // old tokens starting past the removed bytes are where the new scan can
+  // line up with the old one. offsets wrap around when the edit shrinks the
+  // text, which the unsigned sums below undo
+  uint64_t next = relex_first_from(tokens, count, edit_end);
+  uint64_t shift = edit->inserted_length - edit->removed_length;
+
+  parser->tokens = scanned;
+  parser->source = source;
+  parser->source_length = length;
+  parser->current_idx = restart;
+  parser->final = 1;
+  parser->in_comment = 0;
+  parser->in_string = 0;
+  parser->need_more = 0;
+  // lines are worked out from the start of the text, only if something asks
+  parser->line = 1;
+  parser->line_offset = 0;
+  parser->lines_valid = 0;
+
+  // the text from an old token's start on is unchanged, so once the scan
+  // reaches one at a token boundary the rest would come out the same. the old
+  // EOF lines up with the new end at the latest
+  for (;;) {
+    uint64_t position = parser->current_idx;
+
+    while (tokens->offsets[next] + shift < position)
+      next++;
+
+    if (tokens->offsets[next] + shift == position)
+      break;
+
+    parser->start = position;
+    parser_scan_token(parser);
+  }
+
+  parser->tokens = tokens;
+
+  uint64_t removed = next - first;
+
+  if (parser->out_of_memory ||
+      !token_stream_splice(tokens, first, removed, scanned)) {
+    token_stream_destroy(scanned);
+    return 0;
+  }
+
+  for (uint64_t i = first + scanned->size; i < tokens->size; i++)
+    tokens->offsets[i] += shift;
+
+  parser->start = length;
+  parser->current_idx = length;
+
+  changed->first = first;
+  changed->removed = removed;
+  changed->inserted = scanned->size;
+
+  token_stream_destroy(scanned);
+
+  return 1;
+}
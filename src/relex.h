@@ -0,0 +1,43 @@
+#ifndef RELEX_H
+#define RELEX_H
+
+#include "parser.h"
+#include <stdint.h>
+
+// incremental re-lexing for editors: after an edit, only the tokens around it
+// are scanned again and the rest of the stream is reused
+
+// a single replacement in the text, in offsets of the text before it. the new
+// text is passed whole to relex_apply (token lexemes are spans of it), so only
+// the inserted length is needed here
+struct relex_edit_t {
+  uint64_t offset;
+  uint64_t removed_length;
+  uint64_t inserted_length;
+};
+
+// what changed in the token stream: tokens [first, first + removed) of the old
+// stream were replaced by tokens [first, first + inserted) of the new one.
+// tokens after that are the old ones, shifted by the edit's length change.
+// (token lines aren't stored, they're derived from offsets, so moving the
+// offsets moves them too.) for LSP semantic tokens this is a single edit of
+// the data array at first * 5, plus the token right after the range, whose
+// relative position has to be re-encoded
+struct relex_range_t {
+  uint64_t first;
+  uint64_t removed;
+  uint64_t inserted;
+};
+
+// brings parser's tokens, scanned from the text before the edit, up to date
+// with source, the text after it. scanning restarts at the last token whose
+// end (plus the scanner's lookahead) lies before the edit and stops as soon
+// as it lands on the start of an old token past the edit, from where on both
+// scans must agree. errors are reported for the re-scanned bytes only, and
+// parser->error stays set once set. returns 0 if the edit doesn't fit the
+// stream (which is left as it was)
+int relex_apply(struct parser_t *parser, const char *source, uint64_t length,
+                const struct relex_edit_t *edit,
+                struct relex_range_t *changed);
+
+#endif // RELEX_H
@@ -0,0 +1,383 @@
+#include "serve.h"
+#include "alloc.h"
+#include "diagnostics.h"
+#include "output.h"
+#include "parallel_parser.h"
+#include "parser.h"
+#include "pool.h"
+#include "source.h"
+#include "tokenize.h"
+#include "vec.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+
+// starting size of a worker's output buffer, grows (and stays grown) from
+// there
+#define SERVE_OUTPUT_SIZE (64 * 1024)
+
+// pause before accepting again when out of descriptors or memory
+#define SERVE_ACCEPT_BACKOFF_US 10000
+
+VEC_DEFINE(serve_bytes, char)
+
+struct serve_worker_t {
+  // what the parser allocates from, capped at --max-memory
+  struct counting_allocator_t budget;
+  struct parser_t *parser;
+  struct output_t *out;
+  struct diagnostics_t *diagnostics;
+  // the current request's payload, NUL-terminated
+  struct serve_bytes_t payload;
+  // connection being served, -1 between connections, so stopping can cut it
+  // short
+  atomic_int connection;
+};
+
+struct serve_server_t {
+  int listener;
+  atomic_int stopping;
+  struct serve_worker_t *workers;
+  uint32_t worker_count;
+};
+
+// reads exactly length bytes. returns 1 once they're all in, 0 if the peer
+// closed the connection before the first one, -1 on anything else
+static int serve_read(int fd, void *buffer, uint64_t length) {
+  uint64_t done = 0;
+
+  while (done < length) {
+    ssize_t got = read(fd, (char *)buffer + done, length - done);
+
+    if (got < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return -1;
+    }
+
+    if (got == 0)
+      return done == 0 ? 0 : -1;
+
+    done += (uint64_t)got;
+  }
+
+  return 1;
+}
+
+// sends every iovec in full. a client that hung up gets an error here rather
+// than a SIGPIPE for the whole server
+static int serve_send(int fd, struct iovec *iov, int count) {
+  while (count > 0) {
+    struct msghdr message = {.msg_iov = iov, .msg_iovlen = (size_t)count};
+    ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+
+    if (sent < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return 0;
+    }
+
+    // skip past whatever made it out
+    while (count > 0 && (size_t)sent >= iov->iov_len) {
+      sent -= (ssize_t)iov->iov_len;
+      iov++;
+      count--;
+    }
+
+    if (count > 0) {
+      iov->iov_base = (char *)iov->iov_base + sent;
+      iov->iov_len -= (size_t)sent;
+    }
+  }
+
+  return 1;
+}
+
+static int serve_respond(int fd, struct serve_worker_t *worker,
+                         uint32_t status) {
+  struct output_t *out = worker->out;
+  struct diagnostics_t *diagnostics = worker->diagnostics;
+
+  // a buffer that couldn't grow lost part of the output
+  if (out->error)
+    status = 1;
+
+  struct serve_response_t response = {
+      .magic = SERVE_RESPONSE_MAGIC,
+      .status = status,
+      .output_length = out->length,
+      .diagnostics_length = diagnostics->length,
+  };
+  struct iovec iov[3] = {
+      {.iov_base = &response, .iov_len = sizeof(response)},
+      {.iov_base = out->buffer, .iov_len = out->length},
+      {.iov_base = diagnostics->text, .iov_len = diagnostics->length},
+  };
+
+  return serve_send(fd, iov, 3);
+}
+
+static uint32_t serve_tokenize(struct serve_worker_t *worker,
+                               const struct serve_request_t *request) {
+  // one scanner thread per request, the workers are the parallelism
+  struct tokenize_options_t options = {
+      .threads = 1,
+      .binary = request->emit == SERVE_EMIT_BINARY,
+      .max_errors = request->max_errors,
+  };
+  const char *payload = worker->payload.data;
+
+  parser_reset(worker->parser);
+  worker->diagnostics->limit = request->max_errors;
+
+  if (request->input == SERVE_INPUT_SOURCE) {
+    return (uint32_t)tokenize_source(worker->parser, worker->out,
+                                     worker->diagnostics, payload,
+                                     request->length, &options, NULL);
+  }
+
+  // the path is the client's, the daemon's stdin and pipes aren't theirs to
+  // read from
+  struct source_t *source = source_open_file(payload);
+
+  if (source == NULL) {
+    diagnostics_add(worker->diagnostics, "Error reading file: %s\n", payload);
+    return 1;
+  }
+
+  int status = tokenize_source(worker->parser, worker->out,
+                               worker->diagnostics, source->data,
+                               source->length, &options, NULL);
+  source_close(source);
+
+  return (uint32_t)status;
+}
+
+// answers the next request on the connection, returns 0 once it should be
+// closed
+static int serve_request(struct serve_worker_t *worker, int fd) {
+  struct serve_request_t request;
+
+  if (serve_read(fd, &request, sizeof(request)) != 1)
+    return 0;
+
+  output_reset(worker->out);
+  diagnostics_clear(worker->diagnostics);
+  worker->diagnostics->limit = 0;
+
+  // the payload of a request that doesn't check out can't be skipped
+  // reliably, so it ends the connection
+  if (request.magic != SERVE_REQUEST_MAGIC ||
+      request.input > SERVE_INPUT_SOURCE || request.emit > SERVE_EMIT_BINARY ||
+      request.length > SERVE_MAX_PAYLOAD) {
+    diagnostics_add(worker->diagnostics, "Malformed request\n");
+    serve_respond(fd, worker, 1);
+    return 0;
+  }
+
+  if (!serve_bytes_reserve(&worker->payload, request.length + 1)) {
+    diagnostics_add(worker->diagnostics, "Request too large\n");
+    serve_respond(fd, worker, 1);
+    return 0;
+  }
+
+  if (serve_read(fd, worker->payload.data, request.length) != 1)
+    return 0;
+
+  // paths come without a terminator
+  worker->payload.data[request.length] = '\0';
+  worker->payload.size = request.length;
+
+  return serve_respond(fd, worker, serve_tokenize(worker, &request));
+}
+
+// one per worker for the lifetime of the server: every worker blocks in
+// accept on the shared listener and serves the connection it gets to the end
+static void serve_work(void *context, uint32_t index, uint64_t task) {
+  (void)task;
+
+  struct serve_server_t *server = (struct serve_server_t *)context;
+  struct serve_worker_t *worker = &server->workers[index];
+
+  while (!atomic_load(&server->stopping)) {
+    int fd = accept(server->listener, NULL, NULL);
+
+    if (fd < 0) {
+      if (atomic_load(&server->stopping))
+        break;
+
+      if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+          errno == ENOMEM) {
+        usleep(SERVE_ACCEPT_BACKOFF_US);
+      } else if (errno != EINTR && errno != ECONNABORTED) {
+        LOG_ERROR("serve: accept failed: %s", strerror(errno));
+        break;
+      }
+
+      continue;
+    }
+
+    atomic_store(&worker->connection, fd);
+
+    // stopping may have come in between accept and the store, and missed
+    // this connection
+    if (!atomic_load(&server->stopping)) {
+      while (serve_request(worker, fd))
+        ;
+    }
+
+    atomic_store(&worker->connection, -1);
+    close(fd);
+  }
+}
+
+static int serve_bind(int listener, const char *path) {
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+
+  memcpy(address.sun_path, path, strlen(path) + 1);
+
+  if (bind(listener, (struct sockaddr *)&address, sizeof(address)) == 0)
+    return 1;
+
+  if (errno != EADDRINUSE)
+    return 0;
+
+  // a socket file nobody answers on is left over from a server that died,
+  // take it over
+  int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+  int alive = probe >= 0 && connect(probe, (struct sockaddr *)&address,
+                                    sizeof(address)) == 0;
+
+  if (probe >= 0)
+    close(probe);
+
+  if (alive) {
+    errno = EADDRINUSE;
+    return 0;
+  }
+
+  unlink(path);
+
+  return bind(listener, (struct sockaddr *)&address, sizeof(address)) == 0;
+}
+
+static void serve_release(struct serve_server_t *server) {
+  for (uint32_t i = 0; i < server->worker_count; i++) {
+    struct serve_worker_t *worker = &server->workers[i];
+
+    if (worker->parser != NULL)
+      parser_destroy(worker->parser);
+
+    if (worker->out != NULL)
+      output_destroy(worker->out);
+
+    if (worker->diagnostics != NULL)
+      diagnostics_destroy(worker->diagnostics);
+
+    serve_bytes_release(&worker->payload);
+  }
+
+  free(server->workers);
+}
+
+int serve(const struct serve_options_t *options) {
+  const char *path = options->socket_path;
+
+  if (strlen(path) >= sizeof(((struct sockaddr_un *)0)->sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    return 1;
+  }
+
+  struct serve_server_t server = {
+      .listener = socket(AF_UNIX, SOCK_STREAM, 0),
+      .worker_count = options->threads != 0
+                          ? options->threads
+                          : parallel_parser_default_threads(),
+  };
+
+  if (server.listener < 0 || !serve_bind(server.listener, path) ||
+      listen(server.listener, SOMAXCONN) != 0) {
+    fprintf(stderr, "Error listening on socket: %s (%s)\n", path,
+            strerror(errno));
+
+    if (server.listener >= 0)
+      close(server.listener);
+
+    return 1;
+  }
+
+  server.workers = (struct serve_worker_t *)calloc(
+      server.worker_count, sizeof(struct serve_worker_t));
+  int ok = server.workers != NULL;
+
+  for (uint32_t i = 0; ok && i < server.worker_count; i++) {
+    struct serve_worker_t *worker = &server.workers[i];
+
+    counting_allocator_init(&worker->budget, NULL, options->max_memory);
+    worker->parser = parser_create(&worker->budget.allocator);
+    worker->out = output_create_memory(SERVE_OUTPUT_SIZE);
+    worker->diagnostics = diagnostics_create();
+    atomic_init(&worker->connection, -1);
+
+    ok = worker->parser != NULL && worker->out != NULL &&
+         worker->diagnostics != NULL;
+  }
+
+  // the workers inherit the blocked signals, so they're only ever delivered
+  // to the sigwait below
+  sigset_t signals;
+  sigset_t previous;
+
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, &previous);
+
+  struct pool_t *pool =
+      ok ? pool_create(server.worker_count, server.worker_count, serve_work,
+                       &server)
+         : NULL;
+
+  if (pool == NULL) {
+    LOG_ERROR("serve: error starting workers");
+  } else {
+    int received;
+    sigwait(&signals, &received);
+
+    // wake the workers blocked in accept, and the ones waiting on a client
+    // for their next request. a request already read still gets its answer
+    atomic_store(&server.stopping, 1);
+    shutdown(server.listener, SHUT_RDWR);
+
+    for (uint32_t i = 0; i < server.worker_count; i++) {
+      int connection = atomic_load(&server.workers[i].connection);
+
+      if (connection >= 0)
+        shutdown(connection, SHUT_RD);
+    }
+
+    pool_destroy(pool);
+  }
+
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+  if (server.workers != NULL)
+    serve_release(&server);
+
+  close(server.listener);
+  unlink(path);
+
+  return pool != NULL ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stdint.h>
+
+// `serve --socket PATH`: a long-running tokenizer listening on a unix domain
+// socket, for callers that would otherwise start a process per file. every
+// worker keeps a parser, output buffer and diagnostics warm and reuses them
+// from request to request
+//
+// a connection carries any number of requests, one after the other. each is a
+// serve_request_t followed by its payload; the answer is a serve_response_t
+// followed by the output and then the diagnostics. all fields are in host
+// byte order, the socket is local anyway
+
+#define SERVE_REQUEST_MAGIC 0x5145524cu  // "LREQ"
+#define SERVE_RESPONSE_MAGIC 0x5345524cu // "LRES"
+
+// what the payload is
+#define SERVE_INPUT_PATH 0
+#define SERVE_INPUT_SOURCE 1
+
+// how tokens come back: printed like `tokenize`, or as a token_binary stream
+#define SERVE_EMIT_TEXT 0
+#define SERVE_EMIT_BINARY 1
+
+// longest payload accepted, a request over it gets status 1 and the
+// connection is closed
+#define SERVE_MAX_PAYLOAD ((uint64_t)1 << 30)
+
+struct serve_request_t {
+  uint32_t magic;
+  uint8_t input;
+  uint8_t emit;
+  uint16_t reserved;
+  // most errors reported, 0 for all of them
+  uint64_t max_errors;
+  // bytes that follow: the path (no terminator) or the source itself
+  uint64_t length;
+};
+
+struct serve_response_t {
+  uint32_t magic;
+  // what `tokenize` would have exited with: 0, 65 on lexical errors or 1 if
+  // the input couldn't be read or the request was malformed
+  uint32_t status;
+  uint64_t output_length;
+  // what `tokenize` would have written to stderr
+  uint64_t diagnostics_length;
+};
+
+struct serve_options_t {
+  const char *socket_path;
+  // concurrent connections served, 0 means one per core
+  uint32_t threads;
+  // most bytes each worker's scanner may hold, 0 for no limit. a request
+  // over it gets status 1 and TOKENIZE_OUT_OF_MEMORY in its diagnostics
+  uint64_t max_memory;
+};
+
+// listens until SIGINT or SIGTERM, then finishes the requests in flight,
+// removes the socket and returns 0. returns 1 if it can't start listening
+int serve(const struct serve_options_t *options);
+
+#endif // SERVE_H
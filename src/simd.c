@@ -0,0 +1,426 @@
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// plain C versions, used for the tails the vector loops leave behind and on
+// targets without SSE2
+
+static int is_identifier_byte(unsigned char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+static uint64_t scalar_find_string_end(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  while (i < length && data[i] != '"' && data[i] != '\\' &&
+         (unsigned char)data[i] < 0x80)
+    i++;
+
+  return i;
+}
+
+static uint64_t scalar_find_line_end(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  while (i < length && data[i] != '\n')
+    i++;
+
+  return i;
+}
+
+static uint64_t scalar_identifier_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  while (i < length && is_identifier_byte((unsigned char)data[i]))
+    i++;
+
+  return i;
+}
+
+static uint64_t scalar_digit_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  while (i < length && data[i] >= '0' && data[i] <= '9')
+    i++;
+
+  return i;
+}
+
+static uint64_t scalar_whitespace_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  for (; i < length; i++) {
+    char c = data[i];
+
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+      break;
+  }
+
+  return i;
+}
+
+static uint64_t scalar_ascii_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  while (i < length && (unsigned char)data[i] < 0x80)
+    i++;
+
+  return i;
+}
+
+static uint64_t scalar_count_newlines(const char *data, uint64_t length) {
+  uint64_t count = 0;
+
+  for (uint64_t i = 0; i < length; i++)
+    count += data[i] == '\n';
+
+  return count;
+}
+
+#ifdef SIMD_X86
+
+// the byte comparisons are signed, which works out: anything >= 0x80 is
+// negative and so never lands inside an ASCII range
+#define SSE2_IN_RANGE(v, lo, hi)                                               \
+  _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((lo) - 1)),                    \
+                _mm_cmpgt_epi8(_mm_set1_epi8((hi) + 1), v))
+
+#define AVX2_IN_RANGE(v, lo, hi)                                               \
+  _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8((lo) - 1)),           \
+                   _mm256_cmpgt_epi8(_mm256_set1_epi8((hi) + 1), v))
+
+static inline __m128i sse2_identifier_mask(__m128i v) {
+  __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+  __m128i alpha = SSE2_IN_RANGE(lower, 'a', 'z');
+  __m128i digit = SSE2_IN_RANGE(v, '0', '9');
+  __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+
+  return _mm_or_si128(_mm_or_si128(alpha, digit), under);
+}
+
+static inline __m128i sse2_whitespace_mask(__m128i v) {
+  __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+  __m128i tab = _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'));
+  __m128i cr = _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'));
+  __m128i nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+
+  return _mm_or_si128(_mm_or_si128(space, tab), _mm_or_si128(cr, nl));
+}
+
+static uint64_t sse2_find_string_end(const char *data, uint64_t length) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  uint64_t i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i special =
+        _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+    // the top bit of v itself marks the non-ASCII bytes
+    uint32_t stops = (uint32_t)_mm_movemask_epi8(_mm_or_si128(special, v));
+
+    if (stops != 0)
+      return i + (uint64_t)__builtin_ctz(stops);
+  }
+
+  return i + scalar_find_string_end(data + i, length - i);
+}
+
+static uint64_t sse2_find_line_end(const char *data, uint64_t length) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  uint64_t i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+    uint32_t lines = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+
+    if (lines != 0)
+      return i + (uint64_t)__builtin_ctz(lines);
+  }
+
+  return i + scalar_find_line_end(data + i, length - i);
+}
+
+static uint64_t sse2_identifier_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+    uint32_t other =
+        ~(uint32_t)_mm_movemask_epi8(sse2_identifier_mask(v)) & 0xFFFF;
+
+    if (other != 0)
+      return i + (uint64_t)__builtin_ctz(other);
+  }
+
+  return i + scalar_identifier_run(data + i, length - i);
+}
+
+static uint64_t sse2_digit_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+    uint32_t other =
+        ~(uint32_t)_mm_movemask_epi8(SSE2_IN_RANGE(v, '0', '9')) & 0xFFFF;
+
+    if (other != 0)
+      return i + (uint64_t)__builtin_ctz(other);
+  }
+
+  return i + scalar_digit_run(data + i, length - i);
+}
+
+static uint64_t sse2_whitespace_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+    uint32_t other =
+        ~(uint32_t)_mm_movemask_epi8(sse2_whitespace_mask(v)) & 0xFFFF;
+
+    if (other != 0)
+      return i + (uint64_t)__builtin_ctz(other);
+  }
+
+  return i + scalar_whitespace_run(data + i, length - i);
+}
+
+// the top bit of every byte is all movemask looks at
+static uint64_t sse2_ascii_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+    uint32_t other = (uint32_t)_mm_movemask_epi8(v);
+
+    if (other != 0)
+      return i + (uint64_t)__builtin_ctz(other);
+  }
+
+  return i + scalar_ascii_run(data + i, length - i);
+}
+
+static uint64_t sse2_count_newlines(const char *data, uint64_t length) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  uint64_t count = 0;
+  uint64_t i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+    uint32_t lines = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+    count += (uint64_t)__builtin_popcount(lines);
+  }
+
+  return count + scalar_count_newlines(data + i, length - i);
+}
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET static inline __m256i avx2_identifier_mask(__m256i v) {
+  __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+  __m256i alpha = AVX2_IN_RANGE(lower, 'a', 'z');
+  __m256i digit = AVX2_IN_RANGE(v, '0', '9');
+  __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+
+  return _mm256_or_si256(_mm256_or_si256(alpha, digit), under);
+}
+
+AVX2_TARGET static inline __m256i avx2_whitespace_mask(__m256i v) {
+  __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+  __m256i tab = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'));
+  __m256i cr = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'));
+  __m256i nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+
+  return _mm256_or_si256(_mm256_or_si256(space, tab), _mm256_or_si256(cr, nl));
+}
+
+// the AVX2 loops hand their (< 32 byte) tail to the SSE2 versions, which in
+// turn finish with the scalar ones
+
+AVX2_TARGET static uint64_t avx2_find_string_end(const char *data,
+                                                 uint64_t length) {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  uint64_t i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                                      _mm256_cmpeq_epi8(v, backslash));
+    uint32_t stops =
+        (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(special, v));
+
+    if (stops != 0)
+      return i + (uint64_t)__builtin_ctz(stops);
+  }
+
+  return i + sse2_find_string_end(data + i, length - i);
+}
+
+AVX2_TARGET static uint64_t avx2_find_line_end(const char *data,
+                                               uint64_t length) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  uint64_t i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+    uint32_t lines =
+        (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+
+    if (lines != 0)
+      return i + (uint64_t)__builtin_ctz(lines);
+  }
+
+  return i + sse2_find_line_end(data + i, length - i);
+}
+
+AVX2_TARGET static uint64_t avx2_identifier_run(const char *data,
+                                                uint64_t length) {
+  uint64_t i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+    uint32_t other = ~(uint32_t)_mm256_movemask_epi8(avx2_identifier_mask(v));
+
+    if (other != 0)
+      return i + (uint64_t)__builtin_ctz(other);
+  }
+
+  return i + sse2_identifier_run(data + i, length - i);
+}
+
+AVX2_TARGET static uint64_t avx2_digit_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+    uint32_t other =
+        ~(uint32_t)_mm256_movemask_epi8(AVX2_IN_RANGE(v, '0', '9'));
+
+    if (other != 0)
+      return i + (uint64_t)__builtin_ctz(other);
+  }
+
+  return i + sse2_digit_run(data + i, length - i);
+}
+
+AVX2_TARGET static uint64_t avx2_whitespace_run(const char *data,
+                                                uint64_t length) {
+  uint64_t i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+    uint32_t other = ~(uint32_t)_mm256_movemask_epi8(avx2_whitespace_mask(v));
+
+    if (other != 0)
+      return i + (uint64_t)__builtin_ctz(other);
+  }
+
+  return i + sse2_whitespace_run(data + i, length - i);
+}
+
+AVX2_TARGET static uint64_t avx2_ascii_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+    uint32_t other = (uint32_t)_mm256_movemask_epi8(v);
+
+    if (other != 0)
+      return i + (uint64_t)__builtin_ctz(other);
+  }
+
+  return i + sse2_ascii_run(data + i, length - i);
+}
+
+AVX2_TARGET static uint64_t avx2_count_newlines(const char *data,
+                                                uint64_t length) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  uint64_t count = 0;
+  uint64_t i = 0;
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+    uint32_t lines =
+        (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+    count += (uint64_t)__builtin_popcount(lines);
+  }
+
+  return count + sse2_count_newlines(data + i, length - i);
+}
+
+#endif // SIMD_X86
+
+struct simd_kernels_t {
+  const char *name;
+  uint64_t (*find_string_end)(const char *, uint64_t);
+  uint64_t (*find_line_end)(const char *, uint64_t);
+  uint64_t (*identifier_run)(const char *, uint64_t);
+  uint64_t (*digit_run)(const char *, uint64_t);
+  uint64_t (*whitespace_run)(const char *, uint64_t);
+  uint64_t (*ascii_run)(const char *, uint64_t);
+  uint64_t (*count_newlines)(const char *, uint64_t);
+};
+
+#ifdef SIMD_X86
+static struct simd_kernels_t kernels = {
+    "sse2",           sse2_find_string_end, sse2_find_line_end,
+    sse2_identifier_run, sse2_digit_run,    sse2_whitespace_run,
+    sse2_ascii_run,   sse2_count_newlines,
+};
+
+// SSE2 is part of x86-64, AVX2 has to be asked for. this runs before main so
+// the table is never written once threads exist
+__attribute__((constructor)) static void simd_select_kernels(void) {
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    kernels = (struct simd_kernels_t){
+        "avx2",           avx2_find_string_end, avx2_find_line_end,
+        avx2_identifier_run, avx2_digit_run,    avx2_whitespace_run,
+        avx2_ascii_run,   avx2_count_newlines,
+    };
+  }
+}
+#else
+static struct simd_kernels_t kernels = {
+    "scalar",           scalar_find_string_end, scalar_find_line_end,
+    scalar_identifier_run, scalar_digit_run,    scalar_whitespace_run,
+    scalar_ascii_run,   scalar_count_newlines,
+};
+#endif
+
+uint64_t simd_find_string_end(const char *data, uint64_t length) {
+  return kernels.find_string_end(data, length);
+}
+
+uint64_t simd_find_line_end(const char *data, uint64_t length) {
+  return kernels.find_line_end(data, length);
+}
+
+uint64_t simd_identifier_run(const char *data, uint64_t length) {
+  return kernels.identifier_run(data, length);
+}
+
+uint64_t simd_digit_run(const char *data, uint64_t length) {
+  return kernels.digit_run(data, length);
+}
+
+uint64_t simd_whitespace_run(const char *data, uint64_t length) {
+  return kernels.whitespace_run(data, length);
+}
+
+uint64_t simd_ascii_run(const char *data, uint64_t length) {
+  return kernels.ascii_run(data, length);
+}
+
+uint64_t simd_count_newlines(const char *data, uint64_t length) {
+  return kernels.count_newlines(data, length);
+}
+
+const char *simd_implementation(void) { return kernels.name; }
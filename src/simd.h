@@ -0,0 +1,36 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+// vectorised scanning kernels. every function looks at data[0, length) only
+// and returns how many leading bytes belong to the run it measures, so the
+// caller can jump straight past it. the widest implementation the CPU
+// supports (AVX2, SSE2 or plain C) is picked once at startup
+
+// bytes before the first '"', '\\' or byte from 0x80 up: whatever a string
+// literal can't just skip over
+uint64_t simd_find_string_end(const char *data, uint64_t length);
+
+// bytes before the first '\n'
+uint64_t simd_find_line_end(const char *data, uint64_t length);
+
+// leading [A-Za-z0-9_] bytes
+uint64_t simd_identifier_run(const char *data, uint64_t length);
+
+// leading [0-9] bytes
+uint64_t simd_digit_run(const char *data, uint64_t length);
+
+// leading ' ', '\t', '\r' and '\n' bytes
+uint64_t simd_whitespace_run(const char *data, uint64_t length);
+
+// leading bytes below 0x80
+uint64_t simd_ascii_run(const char *data, uint64_t length);
+
+// number of '\n' bytes, doesn't stop early
+uint64_t simd_count_newlines(const char *data, uint64_t length);
+
+// name of the kernel set in use, for diagnostics
+const char *simd_implementation(void);
+
+#endif // SIMD_H
@@ -0,0 +1,168 @@
+#include "source.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+
+#define SOURCE_READ_CHUNK_SIZE (64 * 1024)
+
+// fallback for inputs without a known size: keep doubling a heap buffer
+static int source_read_stream(struct source_t *source, int fd) {
+  uint64_t capacity = SOURCE_READ_CHUNK_SIZE;
+  uint64_t length = 0;
+  char *data = (char *)malloc(capacity);
+
+  if (data == NULL) {
+    LOG_ERROR("Memory allocation failed");
+    return 0;
+  }
+
+  for (;;) {
+    if (length == capacity) {
+      char *grown = (char *)realloc(data, capacity * 2);
+
+      if (grown == NULL) {
+        LOG_ERROR("Memory allocation failed");
+        free(data);
+        return 0;
+      }
+
+      data = grown;
+      capacity *= 2;
+    }
+
+    ssize_t bytes_read = read(fd, data + length, capacity - length);
+
+    if (bytes_read < 0) {
+      if (errno == EINTR)
+        continue;
+
+      free(data);
+      return 0;
+    }
+
+    if (bytes_read == 0)
+      break;
+
+    length += (uint64_t)bytes_read;
+  }
+
+  // keep the empty case identical to an empty mapped file
+  if (length == 0) {
+    free(data);
+    data = "";
+  }
+
+  source->data = data;
+  source->length = length;
+  source->mapped = 0;
+
+  return 1;
+}
+
+static int source_map(struct source_t *source, int fd, uint64_t length) {
+  // mmap refuses zero-length mappings, an empty file is just an empty view
+  if (length == 0) {
+    source->data = "";
+    source->length = 0;
+    source->mapped = 0;
+    return 1;
+  }
+
+  void *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  if (data == MAP_FAILED)
+    return 0;
+
+  // the scanner makes a single forward pass
+  madvise(data, length, MADV_SEQUENTIAL);
+
+  source->data = (const char *)data;
+  source->length = length;
+  source->mapped = 1;
+
+  return 1;
+}
+
+// reads fd whole, mapped if it's a regular file. fd is left open
+static struct source_t *source_load(int fd) {
+  struct source_t *source =
+      (struct source_t *)calloc(1, sizeof(struct source_t));
+
+  if (source == NULL) {
+    LOG_ERROR("Memory allocation failed");
+    return NULL;
+  }
+
+  struct stat info;
+  int loaded = 0;
+
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+    loaded = source_map(source, fd, (uint64_t)info.st_size);
+
+  // not a regular file or the mapping failed, read it the slow way
+  if (!loaded)
+    loaded = source_read_stream(source, fd);
+
+  if (!loaded) {
+    free(source);
+    return NULL;
+  }
+
+  return source;
+}
+
+struct source_t *source_open(const char *filename) {
+  int is_stdin = strcmp(filename, "-") == 0;
+  int fd = is_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+
+  if (fd < 0)
+    return NULL;
+
+  struct source_t *source = source_load(fd);
+
+  // a mapping stays valid after its descriptor is closed
+  if (!is_stdin)
+    close(fd);
+
+  return source;
+}
+
+struct source_t *source_open_file(const char *filename) {
+  // without O_NONBLOCK, opening a FIFO would wait for a writer
+  int fd = open(filename, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+
+  if (fd < 0)
+    return NULL;
+
+  struct stat info;
+  struct source_t *source = NULL;
+
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+    source = source_load(fd);
+
+  close(fd);
+
+  return source;
+}
+
+void source_close(struct source_t *source) {
+  if (source == NULL) {
+    LOG_ERROR("source_close: null source provided");
+    return;
+  }
+
+  if (source->mapped) {
+    munmap((void *)source->data, source->length);
+  } else if (source->length > 0) {
+    free((void *)source->data);
+  }
+
+  free(source);
+}
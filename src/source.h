@@ -0,0 +1,26 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdint.h>
+
+// read-only view of an input file. regular files are mapped straight into
+// memory, anything that can't be mapped (pipes, stdin, ttys) is read into a
+// heap buffer instead. data is NOT NUL-terminated, always go by length
+struct source_t {
+  const char *data;
+  uint64_t length;
+  uint8_t mapped;
+};
+
+// "-" reads from stdin. returns NULL if the file can't be opened or read,
+// saying so is up to the caller (a batch wants it in the file's diagnostics)
+struct source_t *source_open(const char *filename);
+
+// like source_open, but for names that come from someone else: "-" is just a
+// file name, and anything but a regular file (a FIFO, a device, a directory)
+// is refused rather than read
+struct source_t *source_open_file(const char *filename);
+
+void source_close(struct source_t *source);
+
+#endif // SOURCE_H
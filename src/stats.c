@@ -0,0 +1,167 @@
+#include "stats.h"
+#include <time.h>
+
+static const char *stats_phase_names[] = {
+    [STATS_PHASE_READ] = "read",
+    [STATS_PHASE_SCAN] = "scan",
+    [STATS_PHASE_PRINT] = "print",
+    [STATS_PHASE_CACHE] = "cache",
+};
+
+double stats_clock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+double stats_start(struct stats_t *stats) {
+  return stats != NULL ? stats_clock() : 0;
+}
+
+void stats_lap(struct stats_t *stats, enum stats_phase_t phase, double *mark) {
+  if (stats == NULL)
+    return;
+
+  double now = stats_clock();
+
+  stats->phase_seconds[phase] += now - *mark;
+  *mark = now;
+}
+
+void stats_count_types(struct stats_t *stats, const uint8_t *types,
+                       uint64_t count) {
+  for (uint64_t i = 0; i < count; i++)
+    stats->type_counts[types[i] <= NONE ? types[i] : NONE]++;
+
+  stats->tokens += count;
+}
+
+void stats_merge(struct stats_t *into, const struct stats_t *from) {
+  for (int phase = 0; phase < STATS_PHASE_COUNT; phase++)
+    into->phase_seconds[phase] += from->phase_seconds[phase];
+
+  for (int type = 0; type <= NONE; type++)
+    into->type_counts[type] += from->type_counts[type];
+
+  into->files += from->files;
+  into->bytes += from->bytes;
+  into->tokens += from->tokens;
+  into->cache_hits += from->cache_hits;
+  into->token_stream_resizes += from->token_stream_resizes;
+  into->vector_resizes += from->vector_resizes;
+
+  if (from->scanner_peak_bytes > into->scanner_peak_bytes)
+    into->scanner_peak_bytes = from->scanner_peak_bytes;
+}
+
+static double stats_rate(uint64_t amount, double seconds) {
+  return seconds > 0 ? (double)amount / seconds : 0;
+}
+
+static void stats_write_text(const struct stats_t *stats, FILE *file) {
+  double scan = stats->phase_seconds[STATS_PHASE_SCAN];
+
+  fprintf(file, "tokenize stats\n");
+  fprintf(file, "  files                 %llu\n",
+          (unsigned long long)stats->files);
+  fprintf(file, "  bytes                 %llu\n",
+          (unsigned long long)stats->bytes);
+  fprintf(file, "  tokens                %llu\n",
+          (unsigned long long)stats->tokens);
+  fprintf(file, "  cache hits            %llu\n",
+          (unsigned long long)stats->cache_hits);
+
+  for (int phase = 0; phase < STATS_PHASE_COUNT; phase++) {
+    fprintf(file, "  %-5s seconds         %.6f\n", stats_phase_names[phase],
+            stats->phase_seconds[phase]);
+  }
+
+  fprintf(file, "  total seconds         %.6f\n", stats->total_seconds);
+  fprintf(file, "  scan MB/s             %.3f\n",
+          stats_rate(stats->bytes, scan) / 1e6);
+  fprintf(file, "  scan tokens/s         %.1f\n",
+          stats_rate(stats->tokens, scan));
+  fprintf(file, "  keyword hits          %llu\n",
+          (unsigned long long)stats->keyword_hits);
+  fprintf(file, "  keyword misses        %llu\n",
+          (unsigned long long)stats->keyword_misses);
+  fprintf(file, "  token stream resizes  %llu\n",
+          (unsigned long long)stats->token_stream_resizes);
+  fprintf(file, "  vector resizes        %llu\n",
+          (unsigned long long)stats->vector_resizes);
+  fprintf(file, "  allocations           %llu\n",
+          (unsigned long long)stats->memory.allocations);
+  fprintf(file, "  allocated bytes       %llu\n",
+          (unsigned long long)stats->memory.allocated_bytes);
+  fprintf(file, "  scanner peak bytes    %llu\n",
+          (unsigned long long)stats->scanner_peak_bytes);
+  fprintf(file, "  tokens by type\n");
+
+  // only the types that showed up, the full list is in the json
+  for (int type = 0; type <= NONE; type++) {
+    if (stats->type_counts[type] == 0)
+      continue;
+
+    fprintf(file, "    %-19s %llu\n", token_type_name((TokenType)type),
+            (unsigned long long)stats->type_counts[type]);
+  }
+}
+
+static void stats_write_json(const struct stats_t *stats, FILE *file) {
+  fprintf(file, "{\n");
+  fprintf(file, "  \"files\": %llu,\n", (unsigned long long)stats->files);
+  fprintf(file, "  \"bytes\": %llu,\n", (unsigned long long)stats->bytes);
+  fprintf(file, "  \"tokens\": %llu,\n", (unsigned long long)stats->tokens);
+  fprintf(file, "  \"cache_hits\": %llu,\n",
+          (unsigned long long)stats->cache_hits);
+  fprintf(file, "  \"seconds\": {\n");
+
+  for (int phase = 0; phase < STATS_PHASE_COUNT; phase++) {
+    fprintf(file, "    \"%s\": %.9f,\n", stats_phase_names[phase],
+            stats->phase_seconds[phase]);
+  }
+
+  fprintf(file, "    \"total\": %.9f\n", stats->total_seconds);
+  fprintf(file, "  },\n");
+  fprintf(file, "  \"keywords\": {\"hits\": %llu, \"misses\": %llu},\n",
+          (unsigned long long)stats->keyword_hits,
+          (unsigned long long)stats->keyword_misses);
+  fprintf(file,
+          "  \"resizes\": {\"token_stream\": %llu, \"vector\": %llu},\n",
+          (unsigned long long)stats->token_stream_resizes,
+          (unsigned long long)stats->vector_resizes);
+  fprintf(file,
+          "  \"allocations\": {\"count\": %llu, \"bytes\": %llu, "
+          "\"scanner_peak\": %llu},\n",
+          (unsigned long long)stats->memory.allocations,
+          (unsigned long long)stats->memory.allocated_bytes,
+          (unsigned long long)stats->scanner_peak_bytes);
+  fprintf(file, "  \"token_types\": {\n");
+
+  for (int type = 0; type <= NONE; type++) {
+    fprintf(file, "    \"%s\": %llu%s\n", token_type_name((TokenType)type),
+            (unsigned long long)stats->type_counts[type],
+            type < NONE ? "," : "");
+  }
+
+  fprintf(file, "  }\n}\n");
+}
+
+int stats_write(struct stats_t *stats, FILE *file, enum stats_format_t format) {
+  stats->memory = memory_stats_snapshot();
+
+  // keywords are the contiguous AND..WHILE block
+  stats->keyword_hits = 0;
+
+  for (int type = AND; type <= WHILE; type++)
+    stats->keyword_hits += stats->type_counts[type];
+
+  stats->keyword_misses = stats->type_counts[IDENTIFIER];
+
+  if (format == STATS_FORMAT_JSON)
+    stats_write_json(stats, file);
+  else
+    stats_write_text(stats, file);
+
+  return fflush(file) == 0 && !ferror(file);
+}
@@ -0,0 +1,71 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "memory_stats.h"
+#include "token.h"
+#include <stdint.h>
+#include <stdio.h>
+
+// --stats instrumentation for the tokenize pipeline. nothing here is touched
+// from the scanner: phases are timed around whole calls and the per-type
+// counts are taken from the finished token stream, so with stats off the only
+// cost is a NULL check per file
+
+enum stats_phase_t {
+  // mapping (or reading) the source
+  STATS_PHASE_READ,
+  // scanning, including the read in streaming mode where the two interleave
+  STATS_PHASE_SCAN,
+  // formatting tokens into the output, text or binary
+  STATS_PHASE_PRINT,
+  // hashing the source, looking it up and storing the result
+  STATS_PHASE_CACHE,
+  STATS_PHASE_COUNT
+};
+
+enum stats_format_t { STATS_FORMAT_TEXT, STATS_FORMAT_JSON };
+
+struct stats_t {
+  // summed over files, so in a batch they add up across workers and can
+  // exceed total_seconds
+  double phase_seconds[STATS_PHASE_COUNT];
+  double total_seconds;
+  uint64_t files;
+  uint64_t bytes;
+  uint64_t tokens;
+  uint64_t cache_hits;
+  uint64_t type_counts[NONE + 1];
+  uint64_t token_stream_resizes;
+  uint64_t vector_resizes;
+  // most bytes a scanner held at once (the largest of them in a batch), as
+  // counted by its allocator
+  uint64_t scanner_peak_bytes;
+  // every identifier-shaped lexeme goes through keyword_lookup: a hit makes
+  // it a keyword token, a miss an IDENTIFIER. derived from type_counts by
+  // stats_write
+  uint64_t keyword_hits;
+  uint64_t keyword_misses;
+  // process-wide, filled in by stats_write
+  struct memory_stats_t memory;
+};
+
+// monotonic clock in seconds
+double stats_clock(void);
+
+// returns the clock when stats are on, 0 otherwise; pairs with stats_lap
+double stats_start(struct stats_t *stats);
+
+// charges the time since *mark to phase and moves the mark to now. does
+// nothing when stats is NULL
+void stats_lap(struct stats_t *stats, enum stats_phase_t phase, double *mark);
+
+// adds a column of token types to the histogram and keyword counts
+void stats_count_types(struct stats_t *stats, const uint8_t *types,
+                       uint64_t count);
+
+void stats_merge(struct stats_t *into, const struct stats_t *from);
+
+// writes the report, returns 0 on a write error
+int stats_write(struct stats_t *stats, FILE *file, enum stats_format_t format);
+
+#endif // STATS_H
@@ -0,0 +1,279 @@
+#include "table.h"
+#include "hash.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// bit i of a group mask stands for the slot i places after the group start
+
+#if defined(__SSE2__)
+
+static inline uint32_t table_group_match(const uint8_t *group, uint8_t byte) {
+  __m128i control = _mm_loadu_si128((const __m128i *)group);
+  __m128i wanted = _mm_set1_epi8((char)byte);
+
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(control, wanted));
+}
+
+// empty and deleted both have the top bit set, hash fragments never do
+static inline uint32_t table_group_free(const uint8_t *group) {
+  return (uint32_t)_mm_movemask_epi8(
+      _mm_loadu_si128((const __m128i *)group));
+}
+
+#else
+
+static inline uint32_t table_group_match(const uint8_t *group, uint8_t byte) {
+  uint32_t mask = 0;
+
+  for (int i = 0; i < TABLE_GROUP_WIDTH; i++)
+    mask |= (uint32_t)(group[i] == byte) << i;
+
+  return mask;
+}
+
+static inline uint32_t table_group_free(const uint8_t *group) {
+  uint32_t mask = 0;
+
+  for (int i = 0; i < TABLE_GROUP_WIDTH; i++)
+    mask |= (uint32_t)(group[i] >> 7) << i;
+
+  return mask;
+}
+
+#endif
+
+// the top bits pick where probing starts, the low 7 go in the control byte
+static inline uint64_t table_home(const struct table_t *table, uint64_t hash) {
+  return (hash >> 7) & (table->capacity - 1);
+}
+
+static inline uint8_t table_fragment(uint64_t hash) {
+  return (uint8_t)(hash & 0x7F);
+}
+
+static void table_set_control(struct table_t *table, uint64_t slot,
+                              uint8_t byte) {
+  table->control[slot] = byte;
+
+  if (slot < TABLE_GROUP_WIDTH)
+    table->control[table->capacity + slot] = byte;
+}
+
+// first slot that can take a key with this hash. groups are visited at
+// triangular strides, which for a power-of-two capacity covers every slot
+static uint64_t table_free_slot(const struct table_t *table, uint64_t hash) {
+  uint64_t mask = table->capacity - 1;
+  uint64_t position = table_home(table, hash);
+  uint64_t stride = 0;
+
+  for (;;) {
+    uint32_t free_slots = table_group_free(table->control + position);
+
+    if (free_slots != 0)
+      return (position + (uint64_t)__builtin_ctz(free_slots)) & mask;
+
+    stride += TABLE_GROUP_WIDTH;
+    position = (position + stride) & mask;
+  }
+}
+
+static void table_release(const struct table_t *table) {
+  alloc_release(table->allocator, table->control,
+                table->capacity + TABLE_GROUP_WIDTH);
+  alloc_release(table->allocator, table->entries,
+                table->capacity * sizeof(struct table_entry_t));
+}
+
+static int table_allocate(struct table_t *table, uint64_t capacity) {
+  const struct allocator_t *allocator = table->allocator;
+  uint8_t *control =
+      (uint8_t *)alloc_allocate(allocator, capacity + TABLE_GROUP_WIDTH);
+  struct table_entry_t *entries = (struct table_entry_t *)alloc_allocate(
+      allocator, capacity * sizeof(struct table_entry_t));
+
+  if (control == NULL || entries == NULL) {
+    alloc_release(allocator, control, capacity + TABLE_GROUP_WIDTH);
+    alloc_release(allocator, entries,
+                  capacity * sizeof(struct table_entry_t));
+    return 0;
+  }
+
+  memset(control, TABLE_EMPTY, capacity + TABLE_GROUP_WIDTH);
+
+  table->control = control;
+  table->entries = entries;
+  table->capacity = capacity;
+  table->tombstones = 0;
+
+  return 1;
+}
+
+// moves every live entry into fresh arrays of new_capacity slots, dropping
+// the tombstones. leaves the table as it was if that can't be allocated
+static int table_rehash(struct table_t *table, uint64_t new_capacity) {
+  struct table_t old = *table;
+
+  if (!table_allocate(table, new_capacity))
+    return 0;
+
+  for (uint64_t slot = 0; slot < old.capacity; slot++) {
+    if (old.control[slot] & 0x80)
+      continue;
+
+    struct table_entry_t *entry = &old.entries[slot];
+    uint64_t target = table_free_slot(table, entry->hash);
+
+    table_set_control(table, target, table_fragment(entry->hash));
+    table->entries[target] = *entry;
+  }
+
+  if (new_capacity != old.capacity)
+    table->resizes++;
+
+  table_release(&old);
+
+  return 1;
+}
+
+struct table_t *table_create(uint64_t initial_capacity,
+                             const struct allocator_t *allocator) {
+  uint64_t capacity = TABLE_GROUP_WIDTH;
+
+  while (capacity < initial_capacity)
+    capacity *= 2;
+
+  struct table_t *table =
+      (struct table_t *)alloc_zeroed(allocator, sizeof(struct table_t));
+
+  if (table == NULL) {
+    LOG_ERROR("table_create: error allocating memory for table");
+    return NULL;
+  }
+
+  table->allocator = allocator;
+
+  if (!table_allocate(table, capacity)) {
+    LOG_ERROR("table_create: error allocating %llu slots",
+              (unsigned long long)capacity);
+    alloc_release(allocator, table, sizeof(struct table_t));
+    return NULL;
+  }
+
+  return table;
+}
+
+uint64_t table_hash(const char *key, uint64_t length) {
+  return hash_bytes(key, length, 0);
+}
+
+struct table_entry_t *table_find(const struct table_t *table, const char *key,
+                                 uint64_t length, uint64_t hash) {
+  uint64_t mask = table->capacity - 1;
+  uint64_t position = table_home(table, hash);
+  uint64_t stride = 0;
+  uint8_t fragment = table_fragment(hash);
+
+  for (;;) {
+    const uint8_t *group = table->control + position;
+    uint32_t matches = table_group_match(group, fragment);
+
+    while (matches != 0) {
+      uint64_t slot = (position + (uint64_t)__builtin_ctz(matches)) & mask;
+      struct table_entry_t *entry = &table->entries[slot];
+
+      if (entry->hash == hash && entry->length == length &&
+          memcmp(entry->key, key, length) == 0)
+        return entry;
+
+      matches &= matches - 1;
+    }
+
+    // the key would have gone into the first empty slot on its way
+    if (table_group_match(group, TABLE_EMPTY) != 0)
+      return NULL;
+
+    stride += TABLE_GROUP_WIDTH;
+    position = (position + stride) & mask;
+  }
+}
+
+struct table_entry_t *table_insert(struct table_t *table, const char *key,
+                                   uint64_t length, uint64_t hash,
+                                   int *inserted) {
+  struct table_entry_t *entry = table_find(table, key, length, hash);
+
+  *inserted = entry == NULL;
+
+  if (entry != NULL)
+    return entry;
+
+  // past 7/8 full probe sequences get long; if that's mostly tombstones a
+  // rehash in place is enough, otherwise double
+  uint64_t limit = table->capacity - table->capacity / 8;
+
+  if (table->count + table->tombstones + 1 > limit) {
+    uint64_t capacity = table->count + 1 > table->capacity / 2
+                            ? table->capacity * 2
+                            : table->capacity;
+
+    if (!table_rehash(table, capacity)) {
+      LOG_ERROR("table_insert: error growing table to %llu slots",
+                (unsigned long long)capacity);
+      *inserted = 0;
+      return NULL;
+    }
+  }
+
+  uint64_t slot = table_free_slot(table, hash);
+
+  if (table->control[slot] == TABLE_DELETED)
+    table->tombstones--;
+
+  table_set_control(table, slot, table_fragment(hash));
+  table->count++;
+
+  entry = &table->entries[slot];
+  entry->key = key;
+  entry->length = length;
+  entry->hash = hash;
+  entry->value = 0;
+
+  return entry;
+}
+
+int table_remove(struct table_t *table, const char *key, uint64_t length,
+                 uint64_t hash) {
+  struct table_entry_t *entry = table_find(table, key, length, hash);
+
+  if (entry == NULL)
+    return 0;
+
+  // other keys may have probed past this slot, so it can't just be emptied
+  table_set_control(table, (uint64_t)(entry - table->entries), TABLE_DELETED);
+  table->count--;
+  table->tombstones++;
+
+  return 1;
+}
+
+void table_clear(struct table_t *table) {
+  memset(table->control, TABLE_EMPTY, table->capacity + TABLE_GROUP_WIDTH);
+  table->count = 0;
+  table->tombstones = 0;
+}
+
+void table_destroy(struct table_t *table) {
+  if (table == NULL) {
+    LOG_ERROR("table_destroy: null table provided");
+    return;
+  }
+
+  table_release(table);
+  alloc_release(table->allocator, table, sizeof(struct table_t));
+}
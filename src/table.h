@@ -0,0 +1,69 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include "alloc.h"
+#include <stdint.h>
+
+// open-addressing hash table from byte strings to 64-bit values, laid out
+// like a Swiss table: besides the slots there's one control byte per slot
+// holding either "empty", "deleted" or the low 7 bits of the key's hash. a
+// lookup compares a whole group of control bytes against those 7 bits at
+// once and only looks at the slots that matched, so most misses never touch
+// a key. the table grows once it is 7/8 full, so probing always ends
+
+// control byte values; anything below 0x80 is a hash fragment
+#define TABLE_EMPTY 0x80
+#define TABLE_DELETED 0xFE
+
+// how many control bytes are compared at once
+#define TABLE_GROUP_WIDTH 16
+
+struct table_entry_t {
+  // not owned, must stay valid for as long as the entry is in the table
+  const char *key;
+  uint64_t length;
+  // the full hash is kept so growing never has to rehash a key
+  uint64_t hash;
+  uint64_t value;
+};
+
+struct table_t {
+  // capacity + TABLE_GROUP_WIDTH bytes, the tail mirrors the first group so a
+  // group can be loaded from any slot without wrapping
+  uint8_t *control;
+  struct table_entry_t *entries;
+  // a power of two, at least TABLE_GROUP_WIDTH
+  uint64_t capacity;
+  uint64_t count;
+  uint64_t tombstones;
+  uint32_t resizes;
+  // where the table and its arrays come from, NULL for malloc
+  const struct allocator_t *allocator;
+};
+
+struct table_t *table_create(uint64_t initial_capacity,
+                             const struct allocator_t *allocator);
+
+// the hash the table expects for key[0, length)
+uint64_t table_hash(const char *key, uint64_t length);
+
+// the entry for key, or NULL if it isn't in the table
+struct table_entry_t *table_find(const struct table_t *table, const char *key,
+                                 uint64_t length, uint64_t hash);
+
+// the entry for key, added with value 0 if it wasn't in the table yet (which
+// *inserted tells). returns NULL if the table had to grow and couldn't; the
+// pointer is only good until the next insert
+struct table_entry_t *table_insert(struct table_t *table, const char *key,
+                                   uint64_t length, uint64_t hash,
+                                   int *inserted);
+
+// returns 0 if key wasn't in the table
+int table_remove(struct table_t *table, const char *key, uint64_t length,
+                 uint64_t hash);
+
+void table_clear(struct table_t *table);
+
+void table_destroy(struct table_t *table);
+
+#endif // TABLE_H
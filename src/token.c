@@ -1,148 +1,157 @@
 #include "token.h"
+#include "number.h"
 #include <stdio.h>
+#include <string.h>
 
-void print_number_token(struct token_entry_t *entry) {
-  // this is far from ideal, but the tests require printing an int as x.0, and
-  // is not the default C behavior (this was intended for java)
-  // instead, check if it's an int and print accordingly
+struct token_line_t {
+  const char *text;
+  uint8_t length;
+};
 
-  double num = *((double *)(entry->data));
+#define TOKEN_LINE(text) {text, sizeof(text) - 1}
 
-  if (((int)(num)) == num) {
-    // int
-    printf("NUMBER %s %d.0\n", entry->raw, (int)num);
-  } else {
-    printf("NUMBER %s %s\n", entry->raw, entry->raw);
-  }
+// tokens whose output never changes are written as a single precomputed line;
+// keywords qualify too since their lexeme is fixed
+static const struct token_line_t token_lines[] = {
+    [LEFT_PAREN] = TOKEN_LINE("LEFT_PAREN ( null\n"),
+    [RIGHT_PAREN] = TOKEN_LINE("RIGHT_PAREN ) null\n"),
+    [LEFT_BRACE] = TOKEN_LINE("LEFT_BRACE { null\n"),
+    [RIGHT_BRACE] = TOKEN_LINE("RIGHT_BRACE } null\n"),
+    [COMMA] = TOKEN_LINE("COMMA , null\n"),
+    [DOT] = TOKEN_LINE("DOT . null\n"),
+    [MINUS] = TOKEN_LINE("MINUS - null\n"),
+    [PLUS] = TOKEN_LINE("PLUS + null\n"),
+    [SEMICOLON] = TOKEN_LINE("SEMICOLON ; null\n"),
+    [SLASH] = TOKEN_LINE("SLASH / null\n"),
+    [STAR] = TOKEN_LINE("STAR * null\n"),
+    [BANG] = TOKEN_LINE("BANG ! null\n"),
+    [BANG_EQUAL] = TOKEN_LINE("BANG_EQUAL != null\n"),
+    [EQUAL] = TOKEN_LINE("EQUAL = null\n"),
+    [EQUAL_EQUAL] = TOKEN_LINE("EQUAL_EQUAL == null\n"),
+    [GREATER] = TOKEN_LINE("GREATER > null\n"),
+    [GREATER_EQUAL] = TOKEN_LINE("GREATER_EQUAL >= null\n"),
+    [LESS] = TOKEN_LINE("LESS < null\n"),
+    [LESS_EQUAL] = TOKEN_LINE("LESS_EQUAL <= null\n"),
+    [AND] = TOKEN_LINE("AND and null\n"),
+    [CLASS] = TOKEN_LINE("CLASS class null\n"),
+    [ELSE] = TOKEN_LINE("ELSE else null\n"),
+    [FALSE] = TOKEN_LINE("FALSE false null\n"),
+    [FUN] = TOKEN_LINE("FUN fun null\n"),
+    [FOR] = TOKEN_LINE("FOR for null\n"),
+    [IF] = TOKEN_LINE("IF if null\n"),
+    [NIL] = TOKEN_LINE("NIL nil null\n"),
+    [OR] = TOKEN_LINE("OR or null\n"),
+    [PRINT] = TOKEN_LINE("PRINT print null\n"),
+    [RETURN] = TOKEN_LINE("RETURN return null\n"),
+    [SUPER] = TOKEN_LINE("SUPER super null\n"),
+    [THIS] = TOKEN_LINE("THIS this null\n"),
+    [TRUE] = TOKEN_LINE("TRUE true null\n"),
+    [VAR] = TOKEN_LINE("VAR var null\n"),
+    [WHILE] = TOKEN_LINE("WHILE while null\n"),
+    [END_OF_FILE] = TOKEN_LINE("EOF  null\n"),
+    [NONE] = TOKEN_LINE("NONE null\n"),
+};
+
+static const char *token_type_names[] = {
+    [LEFT_PAREN] = "LEFT_PAREN",
+    [RIGHT_PAREN] = "RIGHT_PAREN",
+    [LEFT_BRACE] = "LEFT_BRACE",
+    [RIGHT_BRACE] = "RIGHT_BRACE",
+    [COMMA] = "COMMA",
+    [DOT] = "DOT",
+    [MINUS] = "MINUS",
+    [PLUS] = "PLUS",
+    [SEMICOLON] = "SEMICOLON",
+    [SLASH] = "SLASH",
+    [STAR] = "STAR",
+    [BANG] = "BANG",
+    [BANG_EQUAL] = "BANG_EQUAL",
+    [EQUAL] = "EQUAL",
+    [EQUAL_EQUAL] = "EQUAL_EQUAL",
+    [GREATER] = "GREATER",
+    [GREATER_EQUAL] = "GREATER_EQUAL",
+    [LESS] = "LESS",
+    [LESS_EQUAL] = "LESS_EQUAL",
+    [IDENTIFIER] = "IDENTIFIER",
+    [STRING] = "STRING",
+    [NUMBER] = "NUMBER",
+    [AND] = "AND",
+    [CLASS] = "CLASS",
+    [ELSE] = "ELSE",
+    [FALSE] = "FALSE",
+    [FUN] = "FUN",
+    [FOR] = "FOR",
+    [IF] = "IF",
+    [NIL] = "NIL",
+    [OR] = "OR",
+    [PRINT] = "PRINT",
+    [RETURN] = "RETURN",
+    [SUPER] = "SUPER",
+    [THIS] = "THIS",
+    [TRUE] = "TRUE",
+    [VAR] = "VAR",
+    [WHILE] = "WHILE",
+    [END_OF_FILE] = "EOF",
+    [NONE] = "NONE",
+};
+
+const char *token_type_name(TokenType type) {
+  return type <= NONE ? token_type_names[type] : "UNKNOWN";
 }
 
-void print_keyword_token(char *name, struct token_entry_t *entry) {
-  printf("%s %s null\n", name, (char *)entry->raw);
+#define OUTPUT_LITERAL(out, text) output_write(out, text, sizeof(text) - 1)
+
+void print_number_token(struct output_t *out, const char *source,
+                        struct token_entry_t *entry) {
+  // the literal is the shortest text that reads back as the same double, so
+  // "1.50" prints as 1.5 and integers (however large) as N.0
+  OUTPUT_LITERAL(out, "NUMBER ");
+  output_write(out, source + entry->offset, entry->length);
+  output_write_char(out, ' ');
+
+  char *literal = output_reserve(out, NUMBER_FORMAT_BUFFER_SIZE + 1);
+  uint64_t length = number_format(entry->value.number, literal);
+  literal[length++] = '\n';
+
+  output_commit(out, length);
 }
 
-void print_token_entry(struct token_entry_t *entry) {
-  // the annoying part about c...
-  switch (entry->type) {
+void print_string_token(struct output_t *out, const char *source,
+                        struct token_entry_t *entry, const char *literal,
+                        uint64_t literal_length) {
+  // lexeme includes the surrounding quotes (and escapes), the literal doesn't
+  OUTPUT_LITERAL(out, "STRING ");
+  output_write(out, source + entry->offset, entry->length);
+  output_write_char(out, ' ');
+  output_write(out, literal, literal_length);
+  output_write_char(out, '\n');
+}
 
-  case LEFT_PAREN:
-    printf("LEFT_PAREN ( null\n");
-    break;
-  case RIGHT_PAREN:
-    printf("RIGHT_PAREN ) null\n");
-    break;
-  case LEFT_BRACE:
-    printf("LEFT_BRACE { null\n");
-    break;
-  case RIGHT_BRACE:
-    printf("RIGHT_BRACE } null\n");
-    break;
-  case COMMA:
-    printf("COMMA , null\n");
-    break;
-  case DOT:
-    printf("DOT . null\n");
-    break;
-  case MINUS:
-    printf("MINUS - null\n");
-    break;
-  case PLUS:
-    printf("PLUS + null\n");
-    break;
-  case SEMICOLON:
-    printf("SEMICOLON ; null\n");
-    break;
-  case SLASH:
-    printf("SLASH / null\n");
-    break;
-  case STAR:
-    printf("STAR * null\n");
-    break;
-  case BANG:
-    printf("BANG ! null\n");
-    break;
-  case BANG_EQUAL:
-    printf("BANG_EQUAL != null\n");
-    break;
-  case EQUAL:
-    printf("EQUAL = null\n");
-    break;
-  case EQUAL_EQUAL:
-    printf("EQUAL_EQUAL == null\n");
-    break;
-  case GREATER:
-    printf("GREATER > null\n");
-    break;
-  case GREATER_EQUAL:
-    printf("GREATER_EQUAL >= null\n");
-    break;
-  case LESS:
-    printf("LESS < null\n");
-    break;
-  case LESS_EQUAL:
-    printf("LESS_EQUAL <= null\n");
-    break;
+void print_token_entry(struct output_t *out, const char *source,
+                       struct token_entry_t *entry) {
+  const char *lexeme = source + entry->offset;
+
+  switch (entry->type) {
   case IDENTIFIER:
-    printf("IDENTIFIER %s null\n", (char *)entry->raw);
-    break;
-  case STRING:
-    printf("STRING \"%s\" %s\n", (char *)entry->data, (char *)entry->data);
+    OUTPUT_LITERAL(out, "IDENTIFIER ");
+    output_write(out, lexeme, entry->length);
+    OUTPUT_LITERAL(out, " null\n");
+    break;
+  case STRING: {
+    uint64_t literal_length;
+    const char *literal = token_string_literal(
+        source, entry->offset, entry->length, entry->value, &literal_length);
+
+    print_string_token(out, source, entry, literal, literal_length);
     break;
+  }
   case NUMBER:
-    print_number_token(entry);
-    break;
-  case AND:
-    print_keyword_token("AND", entry);
-    break;
-  case CLASS:
-    print_keyword_token("CLASS", entry);
-    break;
-  case ELSE:
-    print_keyword_token("ELSE", entry);
-    break;
-  case FALSE:
-    print_keyword_token("FALSE", entry);
-    break;
-  case FUN:
-    print_keyword_token("FUN", entry);
-    break;
-  case FOR:
-    print_keyword_token("FOR", entry);
+    print_number_token(out, source, entry);
     break;
-  case IF:
-    print_keyword_token("IF", entry);
-    break;
-  case NIL:
-    print_keyword_token("NIL", entry);
-    break;
-  case OR:
-    print_keyword_token("OR", entry);
-    break;
-  case PRINT:
-    print_keyword_token("PRINT", entry);
-    break;
-  case RETURN:
-    print_keyword_token("RETURN", entry);
-    break;
-  case SUPER:
-    print_keyword_token("SUPER", entry);
-    break;
-  case THIS:
-    print_keyword_token("THIS", entry);
-    break;
-  case TRUE:
-    print_keyword_token("TRUE", entry);
-    break;
-  case VAR:
-    print_keyword_token("VAR", entry);
-    break;
-  case WHILE:
-    print_keyword_token("WHILE", entry);
-    break;
-  case END_OF_FILE:
-    printf("EOF  null\n");
-    break;
-  case NONE:
-    printf("NONE null\n");
+  default: {
+    const struct token_line_t *line = &token_lines[entry->type];
+    output_write(out, line->text, line->length);
     break;
   }
+  }
 }
@@ -1,6 +1,8 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include "output.h"
+#include <stddef.h>
 #include <stdint.h>
 
 typedef enum {
@@ -60,18 +62,66 @@ struct token_keyword_table {
   struct token_keyword_table_entry_t *entries;
   uint32_t size;
   uint32_t capacity;
+  // where the table and its entries come from, NULL for malloc
+  const struct allocator_t *allocator;
 };
 
+// a string literal that had escapes, decoded once into the parser's arena
+struct token_string_t {
+  uint64_t length;
+  // NUL-terminated for convenience
+  char text[];
+};
+
+// inline payload, which member is valid depends on the token type
+union token_value_t {
+  double number;
+  // IDENTIFIER and STRING when the parser interns, see parser_t. a STRING
+  // then has no string member, its literal is the symbol's text
+  uint32_t symbol;
+  // STRING otherwise: NULL when the literal is the lexeme minus its quotes,
+  // which is the case unless it had escapes
+  const struct token_string_t *string;
+};
+
+// a single token as seen through the token stream; the lexeme isn't copied,
+// it's the [offset, offset + length) span of the source buffer
 struct token_entry_t {
   TokenType type;
-  char *raw;
-  void *data;
+  uint64_t offset;
+  uint64_t length;
+  union token_value_t value;
 };
 
-void print_number_token(struct token_entry_t *entry);
+// a STRING token's literal and its length: the decoded copy if it had
+// escapes, the lexeme minus its quotes otherwise. only for tokens scanned
+// without an interner, see token_value_t
+static inline const char *token_string_literal(const char *source,
+                                               uint64_t offset, uint64_t length,
+                                               union token_value_t value,
+                                               uint64_t *literal_length) {
+  if (value.string != NULL) {
+    *literal_length = value.string->length;
+    return value.string->text;
+  }
+
+  *literal_length = length - 2;
+  return source + offset + 1;
+}
+
+// the name a token is printed under, e.g. "LEFT_PAREN" or "EOF"
+const char *token_type_name(TokenType type);
+
+void print_number_token(struct output_t *out, const char *source,
+                        struct token_entry_t *entry);
 
-void print_keyword_token(char *name, struct token_entry_t *entry);
+// the literal is passed in for streams that keep literals apart from the
+// token values
+void print_string_token(struct output_t *out, const char *source,
+                        struct token_entry_t *entry, const char *literal,
+                        uint64_t literal_length);
 
-void print_token_entry(struct token_entry_t *entry);
+void print_token_entry(struct output_t *out, const char *source,
+                       struct token_entry_t *entry);
 
 #endif // TOKEN_H
@@ -0,0 +1,323 @@
+#include "token_binary.h"
+#include "hash.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+
+static const char token_binary_padding[8] = {0};
+
+static uint64_t align8(uint64_t value) { return (value + 7) & ~(uint64_t)7; }
+
+static void token_binary_pad(struct output_t *out, uint64_t written) {
+  output_write(out, token_binary_padding, align8(written) - written);
+}
+
+uint64_t token_binary_hash_source(const char *source, uint64_t length) {
+  // seeding with the version keeps streams from different layouts apart
+  return hash_bytes(source, length, TOKEN_BINARY_VERSION);
+}
+
+void token_binary_write(struct output_t *out, const char *source,
+                        uint64_t source_length, uint64_t source_hash,
+                        struct token_stream_t *tokens, uint8_t error,
+                        struct diagnostics_t *diagnostics) {
+  uint64_t count = tokens->size;
+  uint64_t number_count = 0;
+  uint64_t string_count = 0;
+  uint64_t string_bytes = 0;
+
+  // side tables are sized up front so the header can go out first
+  for (uint64_t i = 0; i < count; i++) {
+    if (tokens->types[i] == NUMBER) {
+      number_count++;
+    } else if (tokens->types[i] == STRING) {
+      uint64_t literal_length;
+
+      token_string_literal(source, tokens->offsets[i], tokens->lengths[i],
+                           tokens->values[i], &literal_length);
+      string_count++;
+      string_bytes += literal_length;
+    }
+  }
+
+  uint64_t diagnostic_bytes = diagnostics != NULL ? diagnostics->length : 0;
+
+  struct token_binary_header_t header = {
+      .magic = TOKEN_BINARY_MAGIC,
+      .version = TOKEN_BINARY_VERSION,
+      .flags = error ? TOKEN_BINARY_FLAG_ERROR : 0,
+      .source_length = source_length,
+      .source_hash = source_hash,
+      .token_count = count,
+      .number_count = number_count,
+      .string_count = string_count,
+      .string_bytes = string_bytes,
+      .diagnostic_count = diagnostics != NULL ? diagnostics->count : 0,
+      .diagnostic_bytes = diagnostic_bytes,
+  };
+
+  header.types_offset = sizeof(header);
+  header.offsets_offset = align8(header.types_offset + count);
+  header.lengths_offset = header.offsets_offset + count * sizeof(uint64_t);
+  header.numbers_offset =
+      align8(header.lengths_offset + count * sizeof(uint32_t));
+  header.string_index_offset =
+      header.numbers_offset + number_count * sizeof(double);
+  header.string_data_offset =
+      header.string_index_offset + (string_count + 1) * sizeof(uint64_t);
+  header.diagnostics_offset = align8(header.string_data_offset + string_bytes);
+  header.total_size = align8(header.diagnostics_offset + diagnostic_bytes);
+
+  output_write(out, (const char *)&header, sizeof(header));
+
+  // the stream is already column-major, the first three sections are copies
+  output_write(out, (const char *)tokens->types, count);
+  token_binary_pad(out, header.types_offset + count);
+  output_write(out, (const char *)tokens->offsets, count * sizeof(uint64_t));
+  output_write(out, (const char *)tokens->lengths, count * sizeof(uint32_t));
+  token_binary_pad(out, header.lengths_offset + count * sizeof(uint32_t));
+
+  for (uint64_t i = 0; i < count; i++) {
+    if (tokens->types[i] == NUMBER)
+      output_write(out, (const char *)&tokens->values[i].number,
+                   sizeof(double));
+  }
+
+  uint64_t literal_offset = 0;
+  output_write(out, (const char *)&literal_offset, sizeof(uint64_t));
+
+  for (uint64_t i = 0; i < count; i++) {
+    if (tokens->types[i] == STRING) {
+      uint64_t literal_length;
+
+      token_string_literal(source, tokens->offsets[i], tokens->lengths[i],
+                           tokens->values[i], &literal_length);
+      literal_offset += literal_length;
+      output_write(out, (const char *)&literal_offset, sizeof(uint64_t));
+    }
+  }
+
+  // literals go in decoded, a reader never has to look at escapes
+  for (uint64_t i = 0; i < count; i++) {
+    if (tokens->types[i] == STRING) {
+      uint64_t literal_length;
+      const char *literal =
+          token_string_literal(source, tokens->offsets[i], tokens->lengths[i],
+                               tokens->values[i], &literal_length);
+
+      output_write(out, literal, literal_length);
+    }
+  }
+
+  token_binary_pad(out, header.string_data_offset + string_bytes);
+
+  if (diagnostic_bytes > 0)
+    output_write(out, diagnostics->text, diagnostic_bytes);
+
+  token_binary_pad(out, header.diagnostics_offset + diagnostic_bytes);
+}
+
+// whether count elements of the given size starting at offset lie inside the
+// buffer, without overflowing on hostile counts
+static int token_binary_section_fits(uint64_t offset, uint64_t count,
+                                     uint64_t size, uint64_t length) {
+  if (offset > length)
+    return 0;
+
+  return count <= (length - offset) / size;
+}
+
+struct token_binary_t *token_binary_view(const void *data, uint64_t length) {
+  const struct token_binary_header_t *header =
+      (const struct token_binary_header_t *)data;
+
+  if (length < sizeof(*header) || header->magic != TOKEN_BINARY_MAGIC ||
+      header->version != TOKEN_BINARY_VERSION ||
+      header->total_size > length) {
+    return NULL;
+  }
+
+  length = header->total_size;
+
+  // sections holding 4 and 8 byte values must be aligned to be read in place.
+  // lengths are only 4 bytes wide but start on 8 all the same
+  uint64_t aligned = header->offsets_offset | header->lengths_offset |
+                     header->numbers_offset | header->string_index_offset;
+
+  if ((aligned & 7) != 0 || header->string_count == UINT64_MAX ||
+      !token_binary_section_fits(header->types_offset, header->token_count, 1,
+                                 length) ||
+      !token_binary_section_fits(header->offsets_offset, header->token_count,
+                                 sizeof(uint64_t), length) ||
+      !token_binary_section_fits(header->lengths_offset, header->token_count,
+                                 sizeof(uint32_t), length) ||
+      !token_binary_section_fits(header->numbers_offset, header->number_count,
+                                 sizeof(double), length) ||
+      !token_binary_section_fits(header->string_index_offset,
+                                 header->string_count + 1, sizeof(uint64_t),
+                                 length) ||
+      !token_binary_section_fits(header->string_data_offset,
+                                 header->string_bytes, 1, length) ||
+      !token_binary_section_fits(header->diagnostics_offset,
+                                 header->diagnostic_bytes, 1, length)) {
+    return NULL;
+  }
+
+  struct token_binary_t *binary =
+      (struct token_binary_t *)calloc(1, sizeof(struct token_binary_t));
+
+  if (binary == NULL) {
+    LOG_ERROR("token_binary_view: error allocating memory for view");
+    return NULL;
+  }
+
+  const char *base = (const char *)data;
+
+  binary->header = header;
+  binary->types = (const uint8_t *)(base + header->types_offset);
+  binary->offsets = (const uint64_t *)(base + header->offsets_offset);
+  binary->lengths = (const uint32_t *)(base + header->lengths_offset);
+  binary->numbers = (const double *)(base + header->numbers_offset);
+  binary->string_index = (const uint64_t *)(base + header->string_index_offset);
+  binary->string_data = base + header->string_data_offset;
+  binary->diagnostics = base + header->diagnostics_offset;
+
+  return binary;
+}
+
+struct token_binary_t *token_binary_open(const char *path) {
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0)
+    return NULL;
+
+  struct stat info;
+
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+      (uint64_t)info.st_size < sizeof(struct token_binary_header_t)) {
+    close(fd);
+    return NULL;
+  }
+
+  uint64_t length = (uint64_t)info.st_size;
+  void *mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // the mapping stays valid after the descriptor is gone
+  close(fd);
+
+  if (mapping == MAP_FAILED)
+    return NULL;
+
+  struct token_binary_t *binary = token_binary_view(mapping, length);
+
+  if (binary == NULL) {
+    munmap(mapping, length);
+    return NULL;
+  }
+
+  binary->mapping = mapping;
+  binary->mapping_length = length;
+
+  return binary;
+}
+
+int token_binary_validate(const struct token_binary_t *binary,
+                          uint64_t source_length, uint64_t source_hash) {
+  const struct token_binary_header_t *header = binary->header;
+
+  if (header->source_length != source_length ||
+      header->source_hash != source_hash) {
+    return 0;
+  }
+
+  uint64_t number_count = 0;
+  uint64_t string_count = 0;
+
+  for (uint64_t i = 0; i < header->token_count; i++) {
+    uint8_t type = binary->types[i];
+    uint64_t offset = binary->offsets[i];
+    uint64_t length = binary->lengths[i];
+
+    if (type >= NONE || offset > source_length ||
+        length > source_length - offset) {
+      return 0;
+    }
+
+    if (type == NUMBER) {
+      number_count++;
+    } else if (type == STRING) {
+      // decoding escapes never makes a literal longer than the lexeme
+      // minus its quotes
+      if (length < 2 || string_count >= header->string_count ||
+          binary->string_index[string_count + 1] <
+              binary->string_index[string_count] ||
+          binary->string_index[string_count + 1] -
+                  binary->string_index[string_count] >
+              length - 2) {
+        return 0;
+      }
+
+      string_count++;
+    }
+  }
+
+  return number_count == header->number_count &&
+         string_count == header->string_count &&
+         binary->string_index[0] == 0 &&
+         binary->string_index[string_count] == header->string_bytes;
+}
+
+int token_binary_next(const struct token_binary_t *binary,
+                      struct token_binary_cursor_t *cursor,
+                      struct token_entry_t *entry) {
+  const struct token_binary_header_t *header = binary->header;
+
+  if (cursor->index >= header->token_count)
+    return 0;
+
+  uint64_t i = cursor->index++;
+
+  entry->type = (TokenType)binary->types[i];
+  entry->offset = binary->offsets[i];
+  entry->length = binary->lengths[i];
+  entry->value = (union token_value_t){0};
+
+  if (entry->type == NUMBER) {
+    if (cursor->number >= header->number_count)
+      return 0;
+
+    entry->value.number = binary->numbers[cursor->number++];
+  } else if (entry->type == STRING) {
+    if (cursor->string >= header->string_count)
+      return 0;
+
+    uint64_t start = binary->string_index[cursor->string];
+    uint64_t end = binary->string_index[cursor->string + 1];
+    cursor->string++;
+
+    if (start > end || end > header->string_bytes)
+      return 0;
+
+    cursor->literal = binary->string_data + start;
+    cursor->literal_length = end - start;
+  }
+
+  return 1;
+}
+
+void token_binary_close(struct token_binary_t *binary) {
+  if (binary == NULL) {
+    LOG_ERROR("token_binary_close: null binary provided");
+    return;
+  }
+
+  if (binary->mapping != NULL)
+    munmap(binary->mapping, binary->mapping_length);
+
+  free(binary);
+}
@@ -0,0 +1,115 @@
+#ifndef TOKEN_BINARY_H
+#define TOKEN_BINARY_H
+
+#include "diagnostics.h"
+#include "output.h"
+#include "token.h"
+#include "token_stream.h"
+#include <stdint.h>
+
+// on-disk token stream. the file is a header followed by sections laid out so
+// that a plain mmap gives usable arrays, no decoding step:
+//
+//   header
+//   types          uint8_t[token_count], TokenType values
+//   offsets        uint64_t[token_count], lexeme start in the source
+//   lengths        uint32_t[token_count], lexeme length
+//   numbers        double[number_count], one per NUMBER token, in order
+//   string index   uint64_t[string_count + 1], literal bounds in string data
+//   string data    char[string_bytes], one literal per STRING token, in order,
+//                  escapes decoded
+//   diagnostics    char[diagnostic_bytes], printed diagnostics, verbatim
+//
+// every section starts on an 8 byte boundary. fields are in host byte order,
+// the magic doubles as a byte order check. lexemes aren't stored, they're spans
+// of the source the stream was made from (identified by length and hash)
+#define TOKEN_BINARY_MAGIC 0x4b4f544cu // "LTOK"
+
+// bump whenever the layout, the TokenType numbering or what a section holds
+// changes
+#define TOKEN_BINARY_VERSION 3
+
+// the source had lexical errors
+#define TOKEN_BINARY_FLAG_ERROR 0x1u
+
+struct token_binary_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t flags;
+  uint32_t reserved;
+  uint64_t source_length;
+  uint64_t source_hash;
+  uint64_t token_count;
+  uint64_t number_count;
+  uint64_t string_count;
+  uint64_t string_bytes;
+  uint64_t diagnostic_count;
+  uint64_t diagnostic_bytes;
+  // byte offsets of each section from the start of the file
+  uint64_t types_offset;
+  uint64_t offsets_offset;
+  uint64_t lengths_offset;
+  uint64_t numbers_offset;
+  uint64_t string_index_offset;
+  uint64_t string_data_offset;
+  uint64_t diagnostics_offset;
+  uint64_t total_size;
+};
+
+// read-only view of a token stream, either mapped from a file or pointing at a
+// buffer owned by the caller
+struct token_binary_t {
+  const struct token_binary_header_t *header;
+  const uint8_t *types;
+  const uint64_t *offsets;
+  const uint32_t *lengths;
+  const double *numbers;
+  const uint64_t *string_index;
+  const char *string_data;
+  const char *diagnostics;
+  // set when the view owns a mapping of its own
+  void *mapping;
+  uint64_t mapping_length;
+};
+
+// position while walking the stream; start zeroed
+struct token_binary_cursor_t {
+  uint64_t index;
+  uint64_t number;
+  uint64_t string;
+  // literal of the last STRING token returned
+  const char *literal;
+  uint64_t literal_length;
+};
+
+// source hash the stream header records
+uint64_t token_binary_hash_source(const char *source, uint64_t length);
+
+// serialises a finished token stream for the given source. diagnostics may be
+// NULL. the caller checks out->error for write failures
+void token_binary_write(struct output_t *out, const char *source,
+                        uint64_t source_length, uint64_t source_hash,
+                        struct token_stream_t *tokens, uint8_t error,
+                        struct diagnostics_t *diagnostics);
+
+// checks the header and section bounds of an in-memory stream. the buffer is
+// not copied and must stay alive (and 8 byte aligned) for the view's lifetime
+struct token_binary_t *token_binary_view(const void *data, uint64_t length);
+
+// maps a stream file read-only, returns NULL if it's missing or malformed
+struct token_binary_t *token_binary_open(const char *path);
+
+// checks every token against the source it's about to be used with: matching
+// length and hash, in-bounds spans, valid types and consistent side tables
+int token_binary_validate(const struct token_binary_t *binary,
+                          uint64_t source_length, uint64_t source_hash);
+
+// hands out the next token with its value filled in (and the cursor's literal
+// for strings), returns 0 once every token has been seen
+int token_binary_next(const struct token_binary_t *binary,
+                      struct token_binary_cursor_t *cursor,
+                      struct token_entry_t *entry);
+
+void token_binary_close(struct token_binary_t *binary);
+
+#endif // TOKEN_BINARY_H
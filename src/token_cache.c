@@ -0,0 +1,124 @@
+#include "token_cache.h"
+#include "output.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+
+#define TOKEN_CACHE_BUFFER_SIZE (256 * 1024)
+
+// room for the separator, a dot, 16 hex digits and the extension or the
+// mkstemp suffix
+#define TOKEN_CACHE_NAME_SIZE 64
+
+static char *token_cache_path(const char *directory, uint64_t source_hash,
+                              int temporary) {
+  size_t size = strlen(directory) + TOKEN_CACHE_NAME_SIZE;
+  char *path = (char *)malloc(size);
+
+  if (path == NULL) {
+    LOG_ERROR("token_cache_path: error allocating memory for path");
+    return NULL;
+  }
+
+  // a template for mkstemp, so workers storing the same source (in this
+  // process or another) each get a file of their own
+  if (temporary) {
+    snprintf(path, size, "%s/.%016llx.XXXXXX", directory,
+             (unsigned long long)source_hash);
+  } else {
+    snprintf(path, size, "%s/%016llx.ltok", directory,
+             (unsigned long long)source_hash);
+  }
+
+  return path;
+}
+
+struct token_binary_t *token_cache_load(const char *directory,
+                                        uint64_t source_length,
+                                        uint64_t source_hash) {
+  char *path = token_cache_path(directory, source_hash, 0);
+
+  if (path == NULL)
+    return NULL;
+
+  struct token_binary_t *binary = token_binary_open(path);
+  free(path);
+
+  if (binary == NULL)
+    return NULL;
+
+  // the spans get used against the live source, never trust them blindly
+  if (!token_binary_validate(binary, source_length, source_hash)) {
+    token_binary_close(binary);
+    return NULL;
+  }
+
+  return binary;
+}
+
+// writes the whole entry to fd and closes it, returns 0 if any of it failed
+static int token_cache_write(int fd, const char *source,
+                             uint64_t source_length, uint64_t source_hash,
+                             struct token_stream_t *tokens, uint8_t error,
+                             struct diagnostics_t *diagnostics) {
+  struct output_t *out = output_create(fd, TOKEN_CACHE_BUFFER_SIZE);
+  int written = 0;
+
+  if (out != NULL) {
+    token_binary_write(out, source, source_length, source_hash, tokens, error,
+                       diagnostics);
+    output_flush(out);
+    written = !out->error;
+    output_destroy(out);
+  }
+
+  if (close(fd) != 0)
+    written = 0;
+
+  return written;
+}
+
+int token_cache_store(const char *directory, const char *source,
+                      uint64_t source_length, uint64_t source_hash,
+                      struct token_stream_t *tokens, uint8_t error,
+                      struct diagnostics_t *diagnostics) {
+  if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+    LOG_ERROR("token_cache_store: cannot create cache directory %s",
+              directory);
+    return 0;
+  }
+
+  char *path = token_cache_path(directory, source_hash, 0);
+  char *temporary = token_cache_path(directory, source_hash, 1);
+  int stored = path != NULL && temporary != NULL;
+
+  if (stored) {
+    int fd = mkstemp(temporary);
+    stored = fd >= 0;
+
+    if (stored) {
+      // mkstemp makes the file private, entries are meant to be shared
+      int shared = fchmod(fd, 0644) == 0;
+
+      stored = token_cache_write(fd, source, source_length, source_hash,
+                                 tokens, error, diagnostics) &&
+               shared && rename(temporary, path) == 0;
+
+      if (!stored)
+        unlink(temporary);
+    }
+
+    if (!stored)
+      LOG_ERROR("token_cache_store: cannot write cache entry %s", path);
+  }
+
+  free(path);
+  free(temporary);
+
+  return stored;
+}
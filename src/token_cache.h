@@ -0,0 +1,26 @@
+#ifndef TOKEN_CACHE_H
+#define TOKEN_CACHE_H
+
+#include "diagnostics.h"
+#include "token_binary.h"
+#include "token_stream.h"
+#include <stdint.h>
+
+// content-addressed store of binary token streams: one file per distinct
+// source, named after its hash, so an unchanged file is served without
+// scanning it again no matter where it lives
+
+// maps the stream cached for this source, NULL on a miss (including stale or
+// damaged entries, which just get rebuilt)
+struct token_binary_t *token_cache_load(const char *directory,
+                                        uint64_t source_length,
+                                        uint64_t source_hash);
+
+// writes the stream to a temporary file and renames it into place, so
+// concurrent runs never see a half written entry. returns 0 on failure
+int token_cache_store(const char *directory, const char *source,
+                      uint64_t source_length, uint64_t source_hash,
+                      struct token_stream_t *tokens, uint8_t error,
+                      struct diagnostics_t *diagnostics);
+
+#endif // TOKEN_CACHE_H
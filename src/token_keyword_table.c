@@ -17,77 +17,115 @@ static uint64_t hash_key(const char *key) {
   return hash;
 }
 
-struct token_keyword_table *hashmap_create(uint32_t initial_capacity) {
-  struct token_keyword_table *map = (struct token_keyword_table *)calloc(
-      1, sizeof(struct token_keyword_table));
-
-  map->size = 0;
-  map->capacity = initial_capacity;
-  map->entries = (struct token_keyword_table_entry_t *)calloc(
-      initial_capacity, sizeof(struct token_keyword_table_entry_t));
-
-  return map;
-}
-
-// add only hashmap; using this for constant lookup table
-void hashmap_put(struct token_keyword_table *map, char *key, TokenType token) {
-  // not dealing with any resize, as this will be a static lookup table
-  if (map->size + 1 > map->capacity) {
-    LOG_ERROR("hashmap_put: exceeded capacity of lookup table");
-  }
-
+// slot for key: where it is, or the empty slot it would go in. the table is
+// never more than half full, so there always is one
+static uint32_t hashmap_slot(struct token_keyword_table_entry_t *entries,
+                             uint32_t capacity, const char *key) {
   // bitmask trick: if capacity guaranteed power of 2,
   // we can just AND the other bits away
   // e.g. 64 = 1000000, we care about those zeroes
   // 64 - 1 = 63 = 0111111, use this as bitmask
-  uint32_t initial_index = hash_key(key) & (map->capacity - 1);
-
-  uint32_t index = initial_index;
+  uint32_t index = hash_key(key) & (capacity - 1);
 
   uint32_t probe_count = 1;
 
-  while (map->entries[index].key != NULL) {
-    // quadratic probing: 0, 1, 2, 4, 9, etc.
-    // i = i_0 + probe_count^2
-    index = initial_index + (probe_count * probe_count) & (map->capacity - 1);
+  while (entries[index].key != NULL && strcmp(entries[index].key, key) != 0) {
+    // triangular probing: i_0, +1, +3, +6, etc. unlike i_0 + probe_count^2
+    // this visits every slot of a power-of-2 table
+    index = (index + probe_count) & (capacity - 1);
     probe_count++;
   }
 
-  // place new element
-  map->entries[index].key = key;
-  map->entries[index].type = token;
+  return index;
+}
+
+static int hashmap_grow(struct token_keyword_table *map) {
+  uint32_t capacity = map->capacity * 2;
+  uint64_t size = capacity * sizeof(struct token_keyword_table_entry_t);
+  struct token_keyword_table_entry_t *entries =
+      (struct token_keyword_table_entry_t *)alloc_zeroed(map->allocator, size);
 
-  map->size++;
+  if (entries == NULL)
+    return 0;
+
+  for (uint32_t i = 0; i < map->capacity; i++) {
+    if (map->entries[i].key != NULL)
+      entries[hashmap_slot(entries, capacity, map->entries[i].key)] =
+          map->entries[i];
+  }
+
+  alloc_release(map->allocator, map->entries,
+                map->capacity * sizeof(struct token_keyword_table_entry_t));
+  map->entries = entries;
+  map->capacity = capacity;
+
+  return 1;
 }
 
-TokenType hashmap_lookup(struct token_keyword_table *map, char *key) {
+struct token_keyword_table *
+hashmap_create(uint32_t initial_capacity, const struct allocator_t *allocator) {
+  struct token_keyword_table *map = (struct token_keyword_table *)alloc_zeroed(
+      allocator, sizeof(struct token_keyword_table));
 
-  uint32_t initial_index = hash_key(key) & (map->capacity - 1);
+  if (map == NULL) {
+    LOG_ERROR("hashmap_create: error allocating memory for table");
+    return NULL;
+  }
 
-  uint32_t index = initial_index;
+  // the masking below needs a power of 2
+  uint32_t capacity = 2;
 
-  uint32_t probe_count = 1;
+  while (capacity < initial_capacity)
+    capacity *= 2;
 
-  // TODO: infinite loop here unless there's an exit condiiton on high load
-  // factors
-  while (map->entries[index].key != NULL &&
-         strcmp(map->entries[index].key, key) != 0 &&
-         probe_count <= map->capacity) {
-    // keys are not equal, but we can keep going
-    index = initial_index + (probe_count * probe_count) & (map->capacity - 1);
-    probe_count++;
+  map->size = 0;
+  map->capacity = capacity;
+  map->allocator = allocator;
+  map->entries = (struct token_keyword_table_entry_t *)alloc_zeroed(
+      allocator, capacity * sizeof(struct token_keyword_table_entry_t));
+
+  if (map->entries == NULL) {
+    LOG_ERROR("hashmap_create: error allocating memory for entries");
+    alloc_release(allocator, map, sizeof(struct token_keyword_table));
+    return NULL;
+  }
+
+  return map;
+}
+
+// add only hashmap; using this for constant lookup table
+void hashmap_put(struct token_keyword_table *map, char *key, TokenType token) {
+  // keep at most half the slots in use so probing stays short and lookups
+  // always hit an empty slot eventually
+  if ((map->size + 1) * 2 > map->capacity && !hashmap_grow(map)) {
+    LOG_ERROR("hashmap_put: error growing lookup table");
+    return;
   }
 
-  if (map->entries[index].key == NULL || probe_count > map->capacity) {
+  uint32_t index = hashmap_slot(map->entries, map->capacity, key);
+
+  if (map->entries[index].key == NULL)
+    map->size++;
+
+  // place new element, or replace the existing one's type
+  map->entries[index].key = key;
+  map->entries[index].type = token;
+}
+
+TokenType hashmap_lookup(struct token_keyword_table *map, char *key) {
+  uint32_t index = hashmap_slot(map->entries, map->capacity, key);
+
+  if (map->entries[index].key == NULL) {
     // didn't find key
     return IDENTIFIER;
-  } else {
-    return map->entries[index].type;
   }
+
+  return map->entries[index].type;
 }
 
 void hashmap_destroy(struct token_keyword_table *map) {
   // user is responsible for freeing items themselves
-  free(map->entries);
-  free(map);
+  alloc_release(map->allocator, map->entries,
+                map->capacity * sizeof(struct token_keyword_table_entry_t));
+  alloc_release(map->allocator, map, sizeof(struct token_keyword_table));
 }
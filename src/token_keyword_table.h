@@ -1,6 +1,7 @@
 #ifndef TOKEN_KEYWORD_TABLE_H
 #define TOKEN_KEYWORD_TABLE_H
 
+#include "alloc.h"
 #include "token.h"
 #include <stddef.h>
 #include <stdint.h>
@@ -8,7 +9,8 @@
 #include <stdlib.h>
 #include <string.h>
 
-struct token_keyword_table *hashmap_create(uint32_t initial_capacity);
+struct token_keyword_table *hashmap_create(uint32_t initial_capacity,
+                                           const struct allocator_t *allocator);
 
 void hashmap_put(struct token_keyword_table *map, char *key, TokenType token);
 
@@ -0,0 +1,220 @@
+#include "token_stream.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void token_stream_release_columns(struct token_stream_t *stream) {
+  const struct allocator_t *allocator = stream->allocator;
+  uint64_t capacity = stream->capacity;
+
+  alloc_release(allocator, stream->types, capacity * sizeof(uint8_t));
+  alloc_release(allocator, stream->offsets, capacity * sizeof(uint64_t));
+  alloc_release(allocator, stream->lengths, capacity * sizeof(uint32_t));
+  alloc_release(allocator, stream->values,
+                capacity * sizeof(union token_value_t));
+}
+
+// moves every column into fresh blocks of new_capacity entries, leaving the
+// stream untouched if any of them can't be allocated. the columns are moved
+// rather than realloc'd one by one, so a failure halfway can't leave them at
+// different sizes
+static int token_stream_resize(struct token_stream_t *stream,
+                               uint64_t new_capacity) {
+  const struct allocator_t *allocator = stream->allocator;
+  uint64_t capacity = stream->capacity;
+  uint64_t kept = stream->size < new_capacity ? stream->size : new_capacity;
+
+  uint8_t *types = alloc_allocate(allocator, new_capacity * sizeof(uint8_t));
+  uint64_t *offsets =
+      alloc_allocate(allocator, new_capacity * sizeof(uint64_t));
+  uint32_t *lengths =
+      alloc_allocate(allocator, new_capacity * sizeof(uint32_t));
+  union token_value_t *values =
+      alloc_allocate(allocator, new_capacity * sizeof(union token_value_t));
+
+  if (types == NULL || offsets == NULL || lengths == NULL || values == NULL) {
+    alloc_release(allocator, types, new_capacity * sizeof(uint8_t));
+    alloc_release(allocator, offsets, new_capacity * sizeof(uint64_t));
+    alloc_release(allocator, lengths, new_capacity * sizeof(uint32_t));
+    alloc_release(allocator, values,
+                  new_capacity * sizeof(union token_value_t));
+    return 0;
+  }
+
+  if (kept > 0) {
+    memcpy(types, stream->types, kept * sizeof(uint8_t));
+    memcpy(offsets, stream->offsets, kept * sizeof(uint64_t));
+    memcpy(lengths, stream->lengths, kept * sizeof(uint32_t));
+    memcpy(values, stream->values, kept * sizeof(union token_value_t));
+  }
+
+  token_stream_release_columns(stream);
+
+  stream->types = types;
+  stream->offsets = offsets;
+  stream->lengths = lengths;
+  stream->values = values;
+
+  if (capacity != 0)
+    stream->resizes++;
+
+  stream->capacity = new_capacity;
+
+  return 1;
+}
+
+struct token_stream_t *
+token_stream_create(uint64_t initial_capacity,
+                    const struct allocator_t *allocator) {
+  if (initial_capacity == 0) {
+    LOG_ERROR("token_stream_create: cannot have initial capacity 0, must be > "
+              "0");
+    return NULL;
+  }
+
+  struct token_stream_t *stream = (struct token_stream_t *)alloc_zeroed(
+      allocator, sizeof(struct token_stream_t));
+
+  if (stream == NULL) {
+    LOG_ERROR("token_stream_create: error allocating memory for stream");
+    return NULL;
+  }
+
+  stream->allocator = allocator;
+
+  if (!token_stream_resize(stream, initial_capacity)) {
+    LOG_ERROR("token_stream_create: error allocating memory for stream "
+              "columns");
+    token_stream_destroy(stream);
+    return NULL;
+  }
+
+  return stream;
+}
+
+int token_stream_reserve(struct token_stream_t *stream, uint64_t capacity) {
+  if (capacity <= stream->capacity)
+    return 1;
+
+  if (capacity > SIZE_MAX / sizeof(uint64_t)) {
+    LOG_ERROR("token_stream_reserve: stream capacity overflow");
+    return 0;
+  }
+
+  if (!token_stream_resize(stream, capacity)) {
+    LOG_ERROR("token_stream_reserve: error allocating memory for %llu tokens",
+              (unsigned long long)capacity);
+    return 0;
+  }
+
+  return 1;
+}
+
+int token_stream_push(struct token_stream_t *stream, TokenType type,
+                      uint64_t offset, uint64_t length,
+                      union token_value_t value) {
+  if (stream->size == stream->capacity) {
+    // the widest column bounds how far we can grow before size_t overflows
+    if (stream->capacity > SIZE_MAX / (2 * sizeof(uint64_t))) {
+      LOG_ERROR("token_stream_push: stream capacity overflow");
+      return 0;
+    }
+
+    if (!token_stream_resize(stream, stream->capacity * 2)) {
+      LOG_ERROR("token_stream_push: errored when attempting to realloc "
+                "stream to larger capacity");
+      return 0;
+    }
+  }
+
+  uint64_t index = stream->size++;
+
+  stream->types[index] = (uint8_t)type;
+  stream->offsets[index] = offset;
+  stream->lengths[index] = (uint32_t)length;
+  stream->values[index] = value;
+
+  return 1;
+}
+
+struct token_entry_t token_stream_get(struct token_stream_t *stream,
+                                      uint64_t index) {
+  struct token_entry_t entry = {
+      .type = (TokenType)stream->types[index],
+      .offset = stream->offsets[index],
+      .length = stream->lengths[index],
+      .value = stream->values[index],
+  };
+
+  return entry;
+}
+
+void token_stream_truncate(struct token_stream_t *stream, uint64_t size) {
+  if (size < stream->size)
+    stream->size = size;
+}
+
+int token_stream_splice(struct token_stream_t *stream, uint64_t first,
+                        uint64_t removed, const struct token_stream_t *insert) {
+  uint64_t tail = stream->size - first - removed;
+  uint64_t size = stream->size - removed + insert->size;
+
+  if (!token_stream_reserve(stream, size)) {
+    LOG_ERROR("token_stream_splice: error growing stream");
+    return 0;
+  }
+
+  uint64_t from = first + removed;
+  uint64_t to = first + insert->size;
+
+  // move the tail into place first, then drop the new tokens in front of it
+  memmove(stream->types + to, stream->types + from, tail * sizeof(uint8_t));
+  memmove(stream->offsets + to, stream->offsets + from,
+          tail * sizeof(uint64_t));
+  memmove(stream->lengths + to, stream->lengths + from,
+          tail * sizeof(uint32_t));
+  memmove(stream->values + to, stream->values + from,
+          tail * sizeof(union token_value_t));
+
+  memcpy(stream->types + first, insert->types, insert->size * sizeof(uint8_t));
+  memcpy(stream->offsets + first, insert->offsets,
+         insert->size * sizeof(uint64_t));
+  memcpy(stream->lengths + first, insert->lengths,
+         insert->size * sizeof(uint32_t));
+  memcpy(stream->values + first, insert->values,
+         insert->size * sizeof(union token_value_t));
+
+  stream->size = size;
+
+  return 1;
+}
+
+void token_stream_drop_front(struct token_stream_t *stream, uint64_t count) {
+  if (count >= stream->size) {
+    stream->size = 0;
+    return;
+  }
+
+  uint64_t size = stream->size - count;
+
+  memmove(stream->types, stream->types + count, size * sizeof(uint8_t));
+  memmove(stream->offsets, stream->offsets + count, size * sizeof(uint64_t));
+  memmove(stream->lengths, stream->lengths + count, size * sizeof(uint32_t));
+  memmove(stream->values, stream->values + count,
+          size * sizeof(union token_value_t));
+
+  stream->size = size;
+}
+
+void token_stream_clear(struct token_stream_t *stream) { stream->size = 0; }
+
+void token_stream_destroy(struct token_stream_t *stream) {
+  if (stream == NULL) {
+    LOG_ERROR("token_stream_destroy: null stream provided");
+    return;
+  }
+
+  token_stream_release_columns(stream);
+  alloc_release(stream->allocator, stream, sizeof(struct token_stream_t));
+}
@@ -0,0 +1,52 @@
+#ifndef TOKEN_STREAM_H
+#define TOKEN_STREAM_H
+
+#include "alloc.h"
+#include "token.h"
+#include <stdint.h>
+
+// packed token storage: one entry per token spread over parallel arrays, so a
+// pass that only cares about types (or spans) walks a single dense array
+struct token_stream_t {
+  uint64_t size;
+  uint64_t capacity;
+  uint8_t *types;
+  uint64_t *offsets;
+  // lexeme lengths; the parser rejects anything past UINT32_MAX bytes
+  uint32_t *lengths;
+  union token_value_t *values;
+  // times the columns have been grown, for --stats
+  uint64_t resizes;
+  // where the columns come from, NULL for malloc
+  const struct allocator_t *allocator;
+};
+
+struct token_stream_t *token_stream_create(uint64_t initial_capacity,
+                                           const struct allocator_t *allocator);
+
+// grows the columns to hold at least capacity tokens, returns 0 on failure
+int token_stream_reserve(struct token_stream_t *stream, uint64_t capacity);
+
+int token_stream_push(struct token_stream_t *stream, TokenType type,
+                      uint64_t offset, uint64_t length,
+                      union token_value_t value);
+
+struct token_entry_t token_stream_get(struct token_stream_t *stream,
+                                      uint64_t index);
+
+void token_stream_truncate(struct token_stream_t *stream, uint64_t size);
+
+// replaces tokens [first, first + removed) with every token of insert, moving
+// the rest up or down. returns 0 (leaving the stream as it was) if it can't
+// grow
+int token_stream_splice(struct token_stream_t *stream, uint64_t first,
+                        uint64_t removed, const struct token_stream_t *insert);
+
+// drops the first count tokens, moving the rest to the front
+void token_stream_drop_front(struct token_stream_t *stream, uint64_t count);
+
+void token_stream_clear(struct token_stream_t *stream);
+
+void token_stream_destroy(struct token_stream_t *stream);
+
+#endif // TOKEN_STREAM_H
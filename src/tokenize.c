@@ -0,0 +1,301 @@
+#include "tokenize.h"
+#include "chunk_reader.h"
+#include "parallel_parser.h"
+#include "source.h"
+#include "token.h"
+#include "token_binary.h"
+#include "token_cache.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STREAM_CHUNK_SIZE (64 * 1024)
+
+// goes in past --max-errors, it's what the run failed on
+static void report_out_of_memory(struct diagnostics_t *errors) {
+  if (errors == NULL) {
+    fputs(TOKENIZE_OUT_OF_MEMORY, stderr);
+    return;
+  }
+
+  uint64_t limit = errors->limit;
+
+  errors->limit = 0;
+  diagnostics_add(errors, TOKENIZE_OUT_OF_MEMORY);
+  errors->limit = limit;
+}
+
+// also past --max-errors, nothing else gets reported for the file
+static void report_unreadable(struct diagnostics_t *errors,
+                              const char *filename) {
+  if (errors == NULL) {
+    fprintf(stderr, "Error reading file: %s\n", filename);
+    return;
+  }
+
+  uint64_t limit = errors->limit;
+
+  errors->limit = 0;
+  diagnostics_add(errors, "Error reading file: %s\n", filename);
+  errors->limit = limit;
+}
+
+int tokenize_stream(struct parser_t *parser, struct output_t *out,
+                    const char *filename,
+                    const struct tokenize_options_t *options,
+                    struct stats_t *stats) {
+  int is_stdin = strcmp(filename, "-") == 0;
+  int fd = is_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+
+  if (fd < 0) {
+    fprintf(stderr, "Error reading file: %s\n", filename);
+    return 0;
+  }
+
+  struct chunk_reader_t *reader =
+      chunk_reader_create(fd, STREAM_CHUNK_SIZE, parser->allocator);
+  struct diagnostics_t *diagnostics = diagnostics_create();
+  struct token_stream_t *tokens = parser_get_tokens(parser);
+  uint64_t resizes = tokens->resizes;
+  int status = reader != NULL ? 1 : -1;
+  double mark = stats_start(stats);
+
+  if (diagnostics != NULL)
+    diagnostics->limit = options->max_errors;
+
+  parser->diagnostics = diagnostics;
+
+  while (status == 1) {
+    status = chunk_reader_next(reader, parser);
+    stats_lap(stats, STATS_PHASE_SCAN, &mark);
+
+    // the chunk's tokens stop short, so none of them go out
+    if (parser->out_of_memory)
+      status = -1;
+
+    // a chunk's errors go out with it, in one write
+    if (diagnostics != NULL)
+      diagnostics_flush(diagnostics, stderr);
+
+    if (stats != NULL && status == 1) {
+      stats->bytes += reader->consumed;
+      stats_count_types(stats, tokens->types, tokens->size);
+    }
+
+    for (uint64_t i = 0; status == 1 && i < tokens->size; i++) {
+      struct token_entry_t entry = token_stream_get(tokens, i);
+      print_token_entry(out, reader->buffer, &entry);
+    }
+
+    // tokens should show up as soon as their chunk is done
+    output_flush(out);
+    stats_lap(stats, STATS_PHASE_PRINT, &mark);
+  }
+
+  if (stats != NULL) {
+    stats->files++;
+    stats->token_stream_resizes += tokens->resizes - resizes;
+  }
+
+  parser->diagnostics = NULL;
+
+  if (diagnostics != NULL)
+    diagnostics_destroy(diagnostics);
+
+  if (reader == NULL || parser->out_of_memory)
+    report_out_of_memory(NULL);
+
+  if (reader != NULL)
+    chunk_reader_destroy(reader);
+
+  if (!is_stdin)
+    close(fd);
+
+  return status == 0;
+}
+
+static void print_tokens(struct output_t *out, const char *source,
+                         struct token_stream_t *tokens) {
+  for (uint64_t i = 0; i < tokens->size; i++) {
+    struct token_entry_t entry = token_stream_get(tokens, i);
+    print_token_entry(out, source, &entry);
+  }
+}
+
+// serves a stream from the cache: its diagnostics are replayed and the tokens
+// printed (or the stream re-emitted as is) without scanning the source
+static int replay_cached(struct output_t *out, struct diagnostics_t *errors,
+                         struct token_binary_t *cached, const char *source,
+                         int binary) {
+  const struct token_binary_header_t *header = cached->header;
+  struct diagnostics_t stored = {
+      .text = (char *)cached->diagnostics,
+      .length = header->diagnostic_bytes,
+      .count = header->diagnostic_count,
+  };
+
+  if (errors != NULL)
+    diagnostics_append(errors, &stored);
+  else
+    fwrite(stored.text, 1, stored.length, stderr);
+
+  if (binary) {
+    output_write(out, (const char *)header, header->total_size);
+  } else {
+    struct token_binary_cursor_t cursor = {0};
+    struct token_entry_t entry;
+
+    // a literal with escapes is only in the stream, decoded
+    while (token_binary_next(cached, &cursor, &entry)) {
+      if (entry.type == STRING)
+        print_string_token(out, source, &entry, cursor.literal,
+                           cursor.literal_length);
+      else
+        print_token_entry(out, source, &entry);
+    }
+  }
+
+  return (header->flags & TOKEN_BINARY_FLAG_ERROR) ? 65 : 0;
+}
+
+int tokenize_source(struct parser_t *parser, struct output_t *out,
+                    struct diagnostics_t *errors, const char *data,
+                    uint64_t length, const struct tokenize_options_t *options,
+                    struct stats_t *stats) {
+  double mark = stats_start(stats);
+
+  // diagnostics are collected and written in one go rather than one write
+  // per error, and streams carry them besides
+  struct diagnostics_t *diagnostics = errors;
+
+  if (errors == NULL) {
+    diagnostics = diagnostics_create();
+
+    if (diagnostics != NULL)
+      diagnostics->limit = options->max_errors;
+  }
+
+  uint64_t hash = 0;
+
+  if (options->binary || options->cache_dir != NULL)
+    hash = token_binary_hash_source(data, length);
+
+  if (options->cache_dir != NULL) {
+    struct token_binary_t *cached =
+        token_cache_load(options->cache_dir, length, hash);
+
+    stats_lap(stats, STATS_PHASE_CACHE, &mark);
+
+    if (cached != NULL) {
+      int exit_code =
+          replay_cached(out, diagnostics, cached, data, options->binary);
+
+      if (diagnostics != NULL && diagnostics != errors) {
+        diagnostics_flush(diagnostics, stderr);
+        diagnostics_destroy(diagnostics);
+      }
+
+      stats_lap(stats, STATS_PHASE_PRINT, &mark);
+
+      if (stats != NULL) {
+        stats->cache_hits++;
+        stats_count_types(stats, cached->types, cached->header->token_count);
+      }
+
+      token_binary_close(cached);
+      return exit_code;
+    }
+  }
+
+  uint32_t threads = options->threads;
+
+  if (threads == 0)
+    threads = parallel_parser_default_threads();
+
+  struct token_stream_t *tokens = parser_get_tokens(parser);
+  uint64_t resizes = tokens->resizes;
+
+  stats_lap(stats, STATS_PHASE_CACHE, &mark);
+
+  parser->diagnostics = diagnostics;
+  parallel_parser_parse(parser, data, length, threads);
+  parser->diagnostics = NULL;
+
+  stats_lap(stats, STATS_PHASE_SCAN, &mark);
+
+  // the tokens stop short, so there's nothing to print or cache. the errors
+  // found up to there still go out
+  if (parser->out_of_memory) {
+    if (diagnostics != NULL && diagnostics != errors) {
+      diagnostics_flush(diagnostics, stderr);
+      diagnostics_destroy(diagnostics);
+    }
+
+    report_out_of_memory(errors);
+    return 1;
+  }
+
+  // out ahead of the tokens, as if they'd been printed while scanning. the
+  // text stays around for the stream and the cache
+  if (diagnostics != NULL && diagnostics != errors &&
+      diagnostics->length != 0) {
+    fwrite(diagnostics->text, 1, diagnostics->length, stderr);
+  }
+
+  if (options->binary) {
+    token_binary_write(out, data, length, hash, tokens, parser->error,
+                       diagnostics);
+  } else {
+    print_tokens(out, data, tokens);
+  }
+
+  stats_lap(stats, STATS_PHASE_PRINT, &mark);
+
+  // an entry without all its diagnostics would replay wrong, so skip storing
+  // if they couldn't be collected or some went over the limit
+  if (options->cache_dir != NULL && diagnostics != NULL &&
+      diagnostics->dropped == 0) {
+    token_cache_store(options->cache_dir, data, length, hash, tokens,
+                      parser->error, diagnostics);
+  }
+
+  stats_lap(stats, STATS_PHASE_CACHE, &mark);
+
+  if (stats != NULL) {
+    stats_count_types(stats, tokens->types, tokens->size);
+    stats->token_stream_resizes += tokens->resizes - resizes;
+  }
+
+  if (diagnostics != NULL && diagnostics != errors)
+    diagnostics_destroy(diagnostics);
+
+  return parser->error ? 65 : 0;
+}
+
+int tokenize_file(struct parser_t *parser, struct output_t *out,
+                  struct diagnostics_t *errors, const char *filename,
+                  const struct tokenize_options_t *options,
+                  struct stats_t *stats) {
+  double mark = stats_start(stats);
+  struct source_t *source = source_open(filename);
+
+  stats_lap(stats, STATS_PHASE_READ, &mark);
+
+  if (source == NULL) {
+    report_unreadable(errors, filename);
+    return 1;
+  }
+
+  if (stats != NULL) {
+    stats->files++;
+    stats->bytes += source->length;
+  }
+
+  int exit_code = tokenize_source(parser, out, errors, source->data,
+                                  source->length, options, stats);
+
+  source_close(source);
+
+  return exit_code;
+}
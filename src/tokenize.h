@@ -0,0 +1,63 @@
+#ifndef TOKENIZE_H
+#define TOKENIZE_H
+
+#include "diagnostics.h"
+#include "output.h"
+#include "parser.h"
+#include "stats.h"
+#include <stdint.h>
+
+// reported (whatever --max-errors says) for an input the scanner ran out of
+// memory on
+#define TOKENIZE_OUT_OF_MEMORY "Error: Ran out of memory while tokenizing.\n"
+
+struct tokenize_options_t {
+  // what was named on the command line: files, directories and @listfiles
+  char **inputs;
+  uint32_t input_count;
+  // directory of cached binary streams, NULL when caching is off
+  const char *cache_dir;
+  // scanner threads for a single file, worker threads for a batch. 0 means
+  // one per core
+  uint32_t threads;
+  uint8_t threads_given;
+  uint8_t stream;
+  uint8_t binary;
+  // most errors reported per file, 0 for all of them
+  uint64_t max_errors;
+  // --max-memory: most bytes a scanner may hold at once, 0 for no limit. a
+  // file that needs more fails with TOKENIZE_OUT_OF_MEMORY and none of its
+  // tokens are printed
+  uint64_t max_memory;
+  // --stats: report format and where to (stderr when NULL)
+  uint8_t stats;
+  enum stats_format_t stats_format;
+  const char *stats_file;
+};
+
+// prints tokens as each chunk of the file (or stdin for "-") completes,
+// returns 0 if the input couldn't be read. stats, when not NULL, accumulates
+// timings and counts for the run (here and in tokenize_file)
+int tokenize_stream(struct parser_t *parser, struct output_t *out,
+                    const char *filename,
+                    const struct tokenize_options_t *options,
+                    struct stats_t *stats);
+
+// tokenizes data[0, length), already in memory, the way tokenize_file does a
+// file. same return values, except there's nothing to fail reading
+int tokenize_source(struct parser_t *parser, struct output_t *out,
+                    struct diagnostics_t *errors, const char *data,
+                    uint64_t length, const struct tokenize_options_t *options,
+                    struct stats_t *stats);
+
+// tokenizes a whole file at once, going through the cache if there is one.
+// diagnostics are collected into errors when given, printed (all at once,
+// ahead of the tokens) otherwise.
+// returns the exit code: 0, 65 on lexical errors or 1 if it can't be read or
+// the scanner runs out of memory
+int tokenize_file(struct parser_t *parser, struct output_t *out,
+                  struct diagnostics_t *errors, const char *filename,
+                  const struct tokenize_options_t *options,
+                  struct stats_t *stats);
+
+#endif // TOKENIZE_H
@@ -0,0 +1,154 @@
+#include "utf8.h"
+#include "simd.h"
+
+uint32_t utf8_decode(const char *data, uint64_t length, uint32_t *code_point) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint8_t lead = bytes[0];
+  uint32_t size;
+  uint32_t value;
+  // the second byte's range is narrower for some leads: that's what rules
+  // out overlong forms, surrogates and code points past U+10FFFF
+  uint8_t low = 0x80;
+  uint8_t high = 0xBF;
+
+  if (lead < 0x80) {
+    *code_point = lead;
+    return 1;
+  }
+
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    size = 2;
+    value = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    size = 3;
+    value = lead & 0x0F;
+    low = lead == 0xE0 ? 0xA0 : 0x80;
+    high = lead == 0xED ? 0x9F : 0xBF;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    size = 4;
+    value = lead & 0x07;
+    low = lead == 0xF0 ? 0x90 : 0x80;
+    high = lead == 0xF4 ? 0x8F : 0xBF;
+  } else {
+    // a continuation byte, or a lead no valid sequence starts with
+    return 0;
+  }
+
+  for (uint32_t i = 1; i < size; i++) {
+    if (i >= length)
+      return UTF8_INCOMPLETE;
+
+    uint8_t byte = bytes[i];
+
+    if (byte < low || byte > high)
+      return 0;
+
+    value = (value << 6) | (byte & 0x3F);
+    low = 0x80;
+    high = 0xBF;
+  }
+
+  *code_point = value;
+
+  return size;
+}
+
+uint32_t utf8_encode(uint32_t code_point, char *out) {
+  uint8_t *bytes = (uint8_t *)out;
+
+  if (code_point < 0x80) {
+    bytes[0] = (uint8_t)code_point;
+    return 1;
+  }
+
+  if (code_point < 0x800) {
+    bytes[0] = (uint8_t)(0xC0 | (code_point >> 6));
+    bytes[1] = (uint8_t)(0x80 | (code_point & 0x3F));
+    return 2;
+  }
+
+  if (code_point < 0x10000) {
+    bytes[0] = (uint8_t)(0xE0 | (code_point >> 12));
+    bytes[1] = (uint8_t)(0x80 | ((code_point >> 6) & 0x3F));
+    bytes[2] = (uint8_t)(0x80 | (code_point & 0x3F));
+    return 3;
+  }
+
+  bytes[0] = (uint8_t)(0xF0 | (code_point >> 18));
+  bytes[1] = (uint8_t)(0x80 | ((code_point >> 12) & 0x3F));
+  bytes[2] = (uint8_t)(0x80 | ((code_point >> 6) & 0x3F));
+  bytes[3] = (uint8_t)(0x80 | (code_point & 0x3F));
+  return 4;
+}
+
+uint64_t utf8_invalid_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+  uint32_t code_point;
+
+  while (i < length && (uint8_t)data[i] >= 0x80) {
+    uint32_t size = utf8_decode(data + i, length - i, &code_point);
+
+    if (size != 0 && size != UTF8_INCOMPLETE)
+      break;
+
+    i++;
+  }
+
+  return i;
+}
+
+uint64_t utf8_valid_run(const char *data, uint64_t length) {
+  uint64_t i = 0;
+  uint32_t code_point;
+
+  for (;;) {
+    i += simd_ascii_run(data + i, length - i);
+
+    if (i == length)
+      return i;
+
+    uint32_t size = utf8_decode(data + i, length - i, &code_point);
+
+    if (size == 0 || size == UTF8_INCOMPLETE)
+      return i;
+
+    i += size;
+  }
+}
+
+uint64_t utf8_count_code_points(const char *data, uint64_t length) {
+  uint64_t ascii = simd_ascii_run(data, length);
+  uint64_t count = ascii;
+
+  // past the ASCII prefix, every byte but a continuation byte starts one
+  for (uint64_t i = ascii; i < length; i++)
+    count += ((uint8_t)data[i] & 0xC0) != 0x80;
+
+  return count;
+}
+
+static int utf8_in_ranges(const struct utf8_range_t *ranges, uint32_t count,
+                          uint32_t code_point) {
+  uint32_t low = 0;
+  uint32_t high = count;
+
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+
+    if (ranges[mid].last < code_point)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low < count && ranges[low].first <= code_point;
+}
+
+int utf8_is_xid_start(uint32_t code_point) {
+  return utf8_in_ranges(utf8_xid_start, utf8_xid_start_count, code_point);
+}
+
+int utf8_is_xid_continue(uint32_t code_point) {
+  return utf8_in_ranges(utf8_xid_continue, utf8_xid_continue_count,
+                        code_point);
+}
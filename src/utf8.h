@@ -0,0 +1,54 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stdint.h>
+
+// UTF-8 decoding for the scanner. source is expected to be UTF-8: non-ASCII
+// identifiers are checked against Unicode's XID_Start and XID_Continue, and
+// anything that doesn't decode is reported. ASCII never comes through here,
+// the scanner handles it byte by byte (or a vector at a time) as before
+
+// what utf8_decode returns for a sequence the end of the data cut short,
+// which may still turn out valid once more data arrives
+#define UTF8_INCOMPLETE 5
+
+// a range of code points, both ends included
+struct utf8_range_t {
+  uint32_t first;
+  uint32_t last;
+};
+
+// generated into utf8_xid.c by tools/utf8_xid.py, sorted and non-overlapping
+extern const struct utf8_range_t utf8_xid_start[];
+extern const uint32_t utf8_xid_start_count;
+extern const struct utf8_range_t utf8_xid_continue[];
+extern const uint32_t utf8_xid_continue_count;
+
+// decodes the sequence at data[0] (length > 0). returns its length and
+// stores the code point, 0 if it's malformed (overlong forms, surrogates and
+// anything past U+10FFFF included) or UTF8_INCOMPLETE if data ends inside
+// what could still be a valid sequence
+uint32_t utf8_decode(const char *data, uint64_t length, uint32_t *code_point);
+
+// leading bytes that don't start a valid sequence, for reporting a malformed
+// stretch at once. stops at ASCII and at a valid sequence; a sequence the end
+// of the data cuts short counts as malformed
+uint64_t utf8_invalid_run(const char *data, uint64_t length);
+
+// leading bytes that are well-formed UTF-8, so length when all of it is.
+// ASCII is skipped a vector at a time
+uint64_t utf8_valid_run(const char *data, uint64_t length);
+
+// writes code_point (a scalar value) to out, returns how many bytes that took
+uint32_t utf8_encode(uint32_t code_point, char *out);
+
+// code points in data[0, length), which is assumed to be valid; each
+// malformed byte counts as one
+uint64_t utf8_count_code_points(const char *data, uint64_t length);
+
+// for code points past ASCII
+int utf8_is_xid_start(uint32_t code_point);
+
+int utf8_is_xid_continue(uint32_t code_point);
+
+#endif // UTF8_H
@@ -0,0 +1,173 @@
+#ifndef VEC_H
+#define VEC_H
+
+#include "alloc.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// typed growable array: VEC_DEFINE(name, type) declares struct name_t, which
+// stores its elements inline in one allocation, and name_* functions to work
+// on it. a zeroed struct is an empty vector, so there's no create call, and
+// everything that can allocate returns 0 (leaving the vector as it was) when
+// it can't. the storage comes from malloc unless allocator is set before the
+// first allocation
+//
+//   VEC_DEFINE(offset_list, uint64_t)
+//
+//   struct offset_list_t offsets = {0};
+//   offset_list_reserve(&offsets, expected);
+//   offset_list_push(&offsets, 42);
+//   offset_list_release(&offsets);
+
+// first allocation when growing from empty without a reserve
+#define VEC_MIN_CAPACITY 16
+
+// quiet in the library build, like LOG_ERROR in log.h
+#ifdef LOX_QUIET
+#define VEC_LOG_ERROR(msg, ...) ((void)0)
+#else
+#define VEC_LOG_ERROR(msg, ...) fprintf(stderr, msg "\n", ##__VA_ARGS__)
+#endif
+
+#define VEC_DEFINE(name, type)                                                 \
+  struct name##_t {                                                            \
+    type *data;                                                                \
+    uint64_t size;                                                             \
+    uint64_t capacity;                                                         \
+    /* times data has been grown, for --stats */                               \
+    uint32_t resizes;                                                          \
+    /* where data comes from, NULL for malloc */                               \
+    const struct allocator_t *allocator;                                       \
+  };                                                                           \
+                                                                               \
+  /* grows to hold at least capacity elements, never shrinks */                \
+  static inline int name##_reserve(struct name##_t *vec, uint64_t capacity) {  \
+    if (capacity <= vec->capacity)                                             \
+      return 1;                                                                \
+                                                                               \
+    if (capacity > SIZE_MAX / sizeof(type)) {                                  \
+      VEC_LOG_ERROR(#name "_reserve: capacity overflow");                      \
+      return 0;                                                                \
+    }                                                                          \
+                                                                               \
+    type *data = (type *)alloc_reallocate(vec->allocator, vec->data,           \
+                                          vec->capacity * sizeof(type),        \
+                                          capacity * sizeof(type));            \
+                                                                               \
+    if (data == NULL) {                                                        \
+      VEC_LOG_ERROR(#name "_reserve: error allocating %llu elements",          \
+                    (unsigned long long)capacity);                             \
+      return 0;                                                                \
+    }                                                                          \
+                                                                               \
+    if (vec->capacity != 0)                                                    \
+      vec->resizes++;                                                          \
+                                                                               \
+    vec->data = data;                                                          \
+    vec->capacity = capacity;                                                  \
+                                                                               \
+    return 1;                                                                  \
+  }                                                                            \
+                                                                               \
+  /* room for count more elements, doubling so pushes stay amortised O(1) */   \
+  static inline int name##_grow(struct name##_t *vec, uint64_t count) {        \
+    if (count <= vec->capacity - vec->size)                                    \
+      return 1;                                                                \
+                                                                               \
+    if (count > UINT64_MAX - vec->size) {                                      \
+      VEC_LOG_ERROR(#name "_grow: size overflow");                             \
+      return 0;                                                                \
+    }                                                                          \
+                                                                               \
+    uint64_t needed = vec->size + count;                                       \
+    uint64_t capacity =                                                        \
+        vec->capacity < VEC_MIN_CAPACITY ? VEC_MIN_CAPACITY : vec->capacity;   \
+                                                                               \
+    while (capacity < needed)                                                  \
+      capacity = capacity > UINT64_MAX / 2 ? needed : capacity * 2;            \
+                                                                               \
+    return name##_reserve(vec, capacity);                                      \
+  }                                                                            \
+                                                                               \
+  static inline int name##_push(struct name##_t *vec, type item) {             \
+    if (vec->size == vec->capacity && !name##_grow(vec, 1))                    \
+      return 0;                                                                \
+                                                                               \
+    vec->data[vec->size++] = item;                                             \
+                                                                               \
+    return 1;                                                                  \
+  }                                                                            \
+                                                                               \
+  static inline int name##_append(struct name##_t *vec, const type *items,     \
+                                  uint64_t count) {                            \
+    if (!name##_grow(vec, count))                                              \
+      return 0;                                                                \
+                                                                               \
+    if (count > 0)                                                             \
+      memcpy(vec->data + vec->size, items, count * sizeof(type));              \
+                                                                               \
+    vec->size += count;                                                        \
+                                                                               \
+    return 1;                                                                  \
+  }                                                                            \
+                                                                               \
+  /* index may be size, which is the same as a push */                         \
+  static inline int name##_insert(struct name##_t *vec, uint64_t index,        \
+                                  type item) {                                 \
+    if (index > vec->size) {                                                   \
+      VEC_LOG_ERROR(#name "_insert: index %llu out of bounds for size %llu",   \
+                    (unsigned long long)index,                                 \
+                    (unsigned long long)vec->size);                            \
+      return 0;                                                                \
+    }                                                                          \
+                                                                               \
+    if (!name##_grow(vec, 1))                                                  \
+      return 0;                                                                \
+                                                                               \
+    memmove(vec->data + index + 1, vec->data + index,                          \
+            (vec->size - index) * sizeof(type));                               \
+    vec->data[index] = item;                                                   \
+    vec->size++;                                                               \
+                                                                               \
+    return 1;                                                                  \
+  }                                                                            \
+                                                                               \
+  /* moves the element out to *removed, unless that's NULL */                  \
+  static inline int name##_remove(struct name##_t *vec, uint64_t index,        \
+                                  type *removed) {                             \
+    if (index >= vec->size) {                                                  \
+      VEC_LOG_ERROR(#name "_remove: index %llu out of bounds for size %llu",   \
+                    (unsigned long long)index,                                 \
+                    (unsigned long long)vec->size);                            \
+      return 0;                                                                \
+    }                                                                          \
+                                                                               \
+    if (removed != NULL)                                                       \
+      *removed = vec->data[index];                                             \
+                                                                               \
+    memmove(vec->data + index, vec->data + index + 1,                          \
+            (vec->size - index - 1) * sizeof(type));                           \
+    vec->size--;                                                               \
+                                                                               \
+    return 1;                                                                  \
+  }                                                                            \
+                                                                               \
+  static inline void name##_truncate(struct name##_t *vec, uint64_t size) {    \
+    if (size < vec->size)                                                      \
+      vec->size = size;                                                        \
+  }                                                                            \
+                                                                               \
+  static inline void name##_clear(struct name##_t *vec) { vec->size = 0; }     \
+                                                                               \
+  /* frees the elements' storage (not anything they point to) and leaves an    \
+   * empty vector behind */                                                    \
+  static inline void name##_release(struct name##_t *vec) {                    \
+    alloc_release(vec->allocator, vec->data, vec->capacity * sizeof(type));    \
+    vec->data = NULL;                                                          \
+    vec->size = 0;                                                             \
+    vec->capacity = 0;                                                         \
+  }
+
+#endif // VEC_H
@@ -0,0 +1,155 @@
+#include "diagnostics.h"
+#include "parser.h"
+#include "token_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+// a buffer scanned a chunk at a time against a whole-buffer scan: the same
+// tokens, diagnostics on the same lines, and no line index built for chunks
+// that report nothing
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+#define TEST_MAX_SOURCE 4096
+
+static int failures = 0;
+
+struct scan_t {
+  struct parser_t *parser;
+  struct diagnostics_t *diagnostics;
+};
+
+static int scan_create(struct scan_t *scan) {
+  scan->parser = parser_create(NULL);
+  scan->diagnostics = diagnostics_create();
+
+  if (scan->parser == NULL || scan->diagnostics == NULL) {
+    fprintf(stderr, "chunked_scan_test: cannot create a parser\n");
+    failures++;
+    return 0;
+  }
+
+  scan->parser->diagnostics = scan->diagnostics;
+
+  return 1;
+}
+
+static void scan_destroy(struct scan_t *scan) {
+  if (scan->parser != NULL)
+    parser_destroy(scan->parser);
+
+  if (scan->diagnostics != NULL)
+    diagnostics_destroy(scan->diagnostics);
+}
+
+// scans source chunk bytes at a time, each chunk picking up where the last
+// one stopped, the way --stream and --threads hand it over
+static void scan_chunked(struct parser_t *parser, const char *source,
+                         uint64_t length, uint64_t chunk) {
+  uint64_t begin = 0;
+  uint64_t end = 0;
+
+  while (end < length) {
+    end = end + chunk < length ? end + chunk : length;
+    begin = parser_scan_range(parser, source, begin, end, end == length);
+  }
+}
+
+static int same_scan(const struct scan_t *a, const struct scan_t *b) {
+  const struct token_stream_t *x = a->parser->tokens;
+  const struct token_stream_t *y = b->parser->tokens;
+
+  if (x->size != y->size || a->parser->error != b->parser->error ||
+      a->diagnostics->length != b->diagnostics->length ||
+      (a->diagnostics->length != 0 &&
+       memcmp(a->diagnostics->text, b->diagnostics->text,
+              a->diagnostics->length) != 0)) {
+    return 0;
+  }
+
+  for (uint64_t i = 0; i < x->size; i++) {
+    if (x->types[i] != y->types[i] || x->offsets[i] != y->offsets[i] ||
+        x->lengths[i] != y->lengths[i]) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+// scans source whole and in chunks of every size up to max_chunk. returns 1
+// if every chunked scan left the line index unbuilt
+static int check_chunked(const char *source, uint64_t max_chunk) {
+  uint64_t length = strlen(source);
+  struct scan_t whole = {0};
+  int unindexed = 1;
+
+  if (!scan_create(&whole))
+    return 0;
+
+  parser_parse(whole.parser, source, length);
+
+  for (uint64_t chunk = 1; chunk <= max_chunk; chunk++) {
+    struct scan_t chunked = {0};
+
+    if (!scan_create(&chunked))
+      break;
+
+    scan_chunked(chunked.parser, source, length, chunk);
+
+    if (!same_scan(&whole, &chunked)) {
+      fprintf(stderr,
+              "chunked_scan_test: %llu byte chunks differ from a whole "
+              "scan\n",
+              (unsigned long long)chunk);
+      failures++;
+    }
+
+    if (chunked.parser->lines != NULL)
+      unindexed = 0;
+
+    scan_destroy(&chunked);
+  }
+
+  scan_destroy(&whole);
+
+  return unindexed;
+}
+
+static void test_clean(void) {
+  char source[TEST_MAX_SOURCE];
+  uint64_t length = 0;
+
+  for (int i = 0; length + 64 < sizeof(source); i++) {
+    length += (uint64_t)snprintf(source + length, sizeof(source) - length,
+                                 "var a%d = \"b\" + %d.5; // c\n", i, i);
+  }
+
+  // only a diagnostic needs the index, and nothing here reports one
+  CHECK(check_chunked(source, 96));
+}
+
+static void test_errors(void) {
+  // one error well into the buffer, its line carried over chunk by chunk
+  check_chunked("var a = 1;\nvar b = 2;\n\nprint a\n+ b;\n// end\n@ x;\n", 16);
+
+  // an error in an early chunk builds the index, later chunks carry the line
+  // over through it
+  check_chunked("@\nvar a;\n\n\"one\ntwo\"\n# b;\nprint a;\n"
+                "\"never closed",
+                16);
+}
+
+int main(void) {
+  test_clean();
+  test_errors();
+
+  return failures != 0;
+}
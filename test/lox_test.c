@@ -0,0 +1,176 @@
+#include "lox.h"
+#include <stdio.h>
+#include <string.h>
+
+// liblox through its public header only: interned identifiers and string
+// literals, and where diagnostics point
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+#define TEST_MAX_TOKENS 64
+
+static int failures = 0;
+
+struct collected_t {
+  struct lox_token_t tokens[TEST_MAX_TOKENS];
+  char literals[TEST_MAX_TOKENS][16];
+  size_t count;
+};
+
+// keeps a copy of every token, literals included (they only hold until the
+// sink returns unless interned)
+static int collect(void *context, const struct lox_token_t *tokens,
+                   size_t count) {
+  struct collected_t *collected = (struct collected_t *)context;
+
+  for (size_t i = 0; i < count && collected->count < TEST_MAX_TOKENS; i++) {
+    size_t at = collected->count++;
+
+    collected->tokens[at] = tokens[i];
+
+    if (tokens[i].literal != NULL && tokens[i].literal_length < 16) {
+      memcpy(collected->literals[at], tokens[i].literal,
+             tokens[i].literal_length);
+      collected->literals[at][tokens[i].literal_length] = '\0';
+    }
+  }
+
+  return 0;
+}
+
+struct reported_t {
+  struct lox_diagnostic_t diagnostics[4];
+  char messages[4][64];
+  size_t count;
+};
+
+static void report(void *context, const struct lox_diagnostic_t *diagnostic) {
+  struct reported_t *reported = (struct reported_t *)context;
+
+  if (reported->count == 4 || diagnostic->length >= 64)
+    return;
+
+  size_t at = reported->count++;
+
+  reported->diagnostics[at] = *diagnostic;
+  memcpy(reported->messages[at], diagnostic->message, diagnostic->length);
+  reported->messages[at][diagnostic->length] = '\0';
+}
+
+static enum lox_status_t lex(struct lox_lexer_t *lexer, const char *source,
+                             struct collected_t *collected) {
+  memset(collected, 0, sizeof(*collected));
+  return lox_lex(lexer, source, strlen(source), collect, collected);
+}
+
+static void test_identical_identifiers(struct lox_lexer_t *lexer) {
+  struct collected_t out;
+
+  // var a = b ; a = a ; EOF
+  CHECK(lex(lexer, "var a = b; a = a;", &out) == LOX_OK);
+  CHECK(out.count == 10);
+  CHECK(out.tokens[1].type == LOX_TOKEN_IDENTIFIER);
+  CHECK(out.tokens[1].symbol == 0);
+  CHECK(out.tokens[3].symbol == 1);
+  CHECK(out.tokens[5].symbol == out.tokens[1].symbol);
+  CHECK(out.tokens[7].symbol == out.tokens[1].symbol);
+  CHECK(out.tokens[0].symbol == LOX_NO_SYMBOL);
+  CHECK(out.tokens[9].type == LOX_TOKEN_EOF);
+
+  // symbols carry over to the next call
+  CHECK(lex(lexer, "b a c", &out) == LOX_OK);
+  CHECK(out.tokens[0].symbol == 1);
+  CHECK(out.tokens[1].symbol == 0);
+  CHECK(out.tokens[2].symbol == 2);
+}
+
+static void test_string_literals(struct lox_lexer_t *lexer) {
+  struct collected_t out;
+
+  // literals are interned decoded, in the same numbering as names
+  CHECK(lex(lexer, "a \"a\" \"\\u{61}\" \"b\\n\" \"b\\n\"", &out) == LOX_OK);
+  CHECK(out.count == 6);
+  CHECK(out.tokens[1].type == LOX_TOKEN_STRING);
+  CHECK(out.tokens[1].symbol == out.tokens[0].symbol);
+  CHECK(out.tokens[2].symbol == out.tokens[0].symbol);
+  CHECK(strcmp(out.literals[2], "a") == 0);
+  CHECK(out.tokens[3].symbol != out.tokens[0].symbol);
+  CHECK(out.tokens[4].symbol == out.tokens[3].symbol);
+  CHECK(strcmp(out.literals[4], "b\n") == 0);
+}
+
+static void test_reset(struct lox_lexer_t *lexer) {
+  struct collected_t out;
+
+  lox_lexer_reset(lexer);
+
+  CHECK(lex(lexer, "z a", &out) == LOX_OK);
+  CHECK(out.tokens[0].symbol == 0);
+  CHECK(out.tokens[1].symbol == 1);
+
+  // and none at all once it's turned off
+  CHECK(lox_lexer_set_interning(lexer, 0));
+  CHECK(lex(lexer, "z \"a\"", &out) == LOX_OK);
+  CHECK(out.tokens[0].symbol == LOX_NO_SYMBOL);
+  CHECK(out.tokens[1].symbol == LOX_NO_SYMBOL);
+  CHECK(strcmp(out.literals[1], "a") == 0);
+}
+
+static void test_diagnostic_columns(struct lox_lexer_t *lexer) {
+  struct collected_t out;
+  struct reported_t reported = {0};
+
+  lox_lexer_set_diagnostic_sink(lexer, report, &reported);
+
+  // columns count code points: é, ü and ï are two bytes each, the emoji four
+  CHECK(lex(lexer,
+            "var \xc3\xa9 = 1;\n"
+            "  \xc3\xbcn\xc3\xaf @ x\n"
+            "\xf0\x9f\x98\x80\"never closed",
+            &out) == LOX_LEXICAL_ERROR);
+  CHECK(reported.count == 3);
+
+  CHECK(strcmp(reported.messages[0],
+               "[line 2] Error: Unexpected character: @") == 0);
+  CHECK(reported.diagnostics[0].offset == 20);
+  CHECK(reported.diagnostics[0].line == 2);
+  CHECK(reported.diagnostics[0].column == 7);
+
+  // the emoji can't start a name
+  CHECK(reported.diagnostics[1].offset == 24);
+  CHECK(reported.diagnostics[1].line == 3);
+  CHECK(reported.diagnostics[1].column == 1);
+
+  CHECK(strcmp(reported.messages[2],
+               "[line 3] Error: Unterminated string.") == 0);
+  CHECK(reported.diagnostics[2].offset == 28);
+  CHECK(reported.diagnostics[2].line == 3);
+  CHECK(reported.diagnostics[2].column == 2);
+
+  lox_lexer_set_diagnostic_sink(lexer, NULL, NULL);
+}
+
+int main(void) {
+  struct lox_lexer_t *lexer = lox_lexer_create();
+
+  if (lexer == NULL || !lox_lexer_set_interning(lexer, 1)) {
+    fprintf(stderr, "lox_test: cannot create lexer\n");
+    return 1;
+  }
+
+  test_identical_identifiers(lexer);
+  test_string_literals(lexer);
+  test_reset(lexer);
+  test_diagnostic_columns(lexer);
+
+  lox_lexer_destroy(lexer);
+
+  return failures != 0;
+}
@@ -0,0 +1,145 @@
+#include "parser.h"
+#include "relex.h"
+#include "token_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+// relex_apply against a full scan of the edited text: whatever the edit,
+// the patched stream has to come out the same
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+#define TEST_MAX_SOURCE 256
+
+static int failures = 0;
+
+static int same_tokens(const struct token_stream_t *a,
+                       const struct token_stream_t *b) {
+  if (a->size != b->size)
+    return 0;
+
+  for (uint64_t i = 0; i < a->size; i++) {
+    if (a->types[i] != b->types[i] || a->offsets[i] != b->offsets[i] ||
+        a->lengths[i] != b->lengths[i]) {
+      return 0;
+    }
+
+    if (a->types[i] == NUMBER &&
+        a->values[i].number != b->values[i].number) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+// replaces removed bytes at offset of before with inserted, relexes and
+// compares. returns what changed, for the cases that check it
+static struct relex_range_t check_edit(const char *before, uint64_t offset,
+                                       uint64_t removed,
+                                       const char *inserted) {
+  struct relex_range_t changed = {0};
+  char after[TEST_MAX_SOURCE];
+  uint64_t before_length = strlen(before);
+  uint64_t inserted_length = strlen(inserted);
+  uint64_t length = before_length - removed + inserted_length;
+
+  memcpy(after, before, offset);
+  memcpy(after + offset, inserted, inserted_length);
+  memcpy(after + offset + inserted_length, before + offset + removed,
+         before_length - offset - removed);
+
+  struct parser_t *edited = parser_create(NULL);
+  struct parser_t *fresh = parser_create(NULL);
+
+  if (edited == NULL || fresh == NULL) {
+    fprintf(stderr, "relex_test: cannot create parsers\n");
+    failures++;
+    return changed;
+  }
+
+  parser_parse(edited, before, before_length);
+
+  uint64_t old_size = edited->tokens->size;
+  struct relex_edit_t edit = {
+      .offset = offset,
+      .removed_length = removed,
+      .inserted_length = inserted_length,
+  };
+
+  CHECK(relex_apply(edited, after, length, &edit, &changed));
+  parser_parse(fresh, after, length);
+
+  if (!same_tokens(edited->tokens, fresh->tokens)) {
+    fprintf(stderr, "relex_test: \"%s\" -> \"%.*s\" differs from a scan\n",
+            before, (int)length, after);
+    failures++;
+  }
+
+  CHECK(edited->tokens->size ==
+        old_size - changed.removed + changed.inserted);
+
+  parser_destroy(edited);
+  parser_destroy(fresh);
+
+  return changed;
+}
+
+static void test_shrink(void) {
+  check_edit("var foo = 123;", 5, 2, "");
+  check_edit("a b", 1, 1, "");
+  check_edit("x = 12.5;", 3, 3, "");
+  check_edit("// note\nprint a;", 0, 3, "");
+  check_edit("\"one\" \"two\"", 4, 3, "");
+
+  // a token far from the edit is shifted, not scanned again
+  struct relex_range_t changed =
+      check_edit("a; b; c; d; e; f; g;", 9, 3, "");
+  CHECK(changed.first > 0);
+  CHECK(changed.removed <= 4);
+}
+
+static void test_grow(void) {
+  check_edit("print a + b;", 7, 0, "bcd");
+  check_edit("a b", 1, 0, "nd");
+  check_edit("x = 1;", 5, 0, ".5");
+  check_edit("a = b;", 0, 0, "// ");
+  check_edit("a = b;", 4, 0, "\"c\" + ");
+  check_edit("a = \"b\";", 6, 0, "\\n");
+
+  struct relex_range_t changed =
+      check_edit("a; b; c; d; e; f; g;", 12, 0, " x; y;");
+  CHECK(changed.first > 0);
+  CHECK(changed.inserted >= changed.removed + 4);
+}
+
+static void test_eof(void) {
+  // edits touching the end of the text, where only EOF follows
+  check_edit("x = 1", 5, 0, ".5");
+  check_edit("a + bc", 5, 1, "");
+  check_edit("a + b", 5, 0, " or c");
+  check_edit("print a", 0, 7, "");
+  check_edit("", 0, 0, "var a;");
+
+  // appending to the last token rescans the tokens near it, the old EOF just
+  // moves
+  struct relex_range_t changed = check_edit("a b c d", 7, 0, "e");
+  CHECK(changed.first == 2);
+  CHECK(changed.removed == 2);
+  CHECK(changed.inserted == 2);
+}
+
+int main(void) {
+  test_shrink();
+  test_grow();
+  test_eof();
+
+  return failures != 0;
+}
@@ -0,0 +1,280 @@
+#include "serve.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// `interpreter serve` over its socket: a well formed request, paths it
+// mustn't read, then the requests that must be refused.
+// usage: serve_test INTERPRETER
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+// how long the server gets to start listening, in 10ms tries
+#define TEST_CONNECT_TRIES 500
+
+#define TEST_MAX_ANSWER 4096
+
+static int failures = 0;
+
+struct answer_t {
+  struct serve_response_t response;
+  char output[TEST_MAX_ANSWER];
+  char diagnostics[TEST_MAX_ANSWER];
+};
+
+static int test_connect(const char *path) {
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+
+  if (fd >= 0 &&
+      connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+    close(fd);
+    fd = -1;
+  }
+
+  return fd;
+}
+
+// returns 0 if the server never starts listening
+static int test_wait_for_server(const char *path) {
+  for (int i = 0; i < TEST_CONNECT_TRIES; i++) {
+    int fd = test_connect(path);
+
+    if (fd >= 0) {
+      close(fd);
+      return 1;
+    }
+
+    usleep(10 * 1000);
+  }
+
+  return 0;
+}
+
+static int test_send(int fd, const void *data, size_t length) {
+  const char *at = (const char *)data;
+
+  while (length > 0) {
+    ssize_t sent = write(fd, at, length);
+
+    if (sent <= 0)
+      return 0;
+
+    at += sent;
+    length -= (size_t)sent;
+  }
+
+  return 1;
+}
+
+static int test_receive(int fd, void *data, uint64_t length) {
+  char *at = (char *)data;
+
+  while (length > 0) {
+    ssize_t got = read(fd, at, length);
+
+    if (got <= 0)
+      return 0;
+
+    at += got;
+    length -= (uint64_t)got;
+  }
+
+  return 1;
+}
+
+// reads one response, text NUL-terminated. returns 0 if it doesn't come
+// whole or doesn't fit
+static int test_answer(int fd, struct answer_t *answer) {
+  memset(answer, 0, sizeof(*answer));
+
+  struct serve_response_t *response = &answer->response;
+
+  return test_receive(fd, response, sizeof(*response)) &&
+         response->magic == SERVE_RESPONSE_MAGIC &&
+         response->output_length < TEST_MAX_ANSWER &&
+         response->diagnostics_length < TEST_MAX_ANSWER &&
+         test_receive(fd, answer->output, response->output_length) &&
+         test_receive(fd, answer->diagnostics, response->diagnostics_length);
+}
+
+// the server hangs up after refusing a request
+static int test_closed(int fd) {
+  char byte;
+
+  return read(fd, &byte, 1) == 0;
+}
+
+static void test_source(const char *path) {
+  int fd = test_connect(path);
+  const char source[] = "var a = \"b";
+  struct serve_request_t request = {
+      .magic = SERVE_REQUEST_MAGIC,
+      .input = SERVE_INPUT_SOURCE,
+      .emit = SERVE_EMIT_TEXT,
+      .length = sizeof(source) - 1,
+  };
+  struct answer_t answer;
+
+  CHECK(fd >= 0);
+  CHECK(test_send(fd, &request, sizeof(request)));
+  CHECK(test_send(fd, source, sizeof(source) - 1));
+  CHECK(test_answer(fd, &answer));
+  CHECK(answer.response.status == 65);
+  CHECK(strcmp(answer.output, "VAR var null\nIDENTIFIER a null\n"
+                              "EQUAL = null\nEOF  null\n") == 0);
+  CHECK(strcmp(answer.diagnostics,
+               "[line 1] Error: Unterminated string.\n") == 0);
+
+  close(fd);
+}
+
+// a path the server mustn't read: "-" isn't its stdin, and a directory or
+// anything else that isn't a regular file is turned down. the request itself
+// is fine, so the connection stays open
+static void test_not_a_file(const char *path, const char *file) {
+  int fd = test_connect(path);
+  struct serve_request_t request = {
+      .magic = SERVE_REQUEST_MAGIC,
+      .input = SERVE_INPUT_PATH,
+      .emit = SERVE_EMIT_TEXT,
+      .length = strlen(file),
+  };
+  char expected[TEST_MAX_ANSWER];
+  struct answer_t answer;
+
+  snprintf(expected, sizeof(expected), "Error reading file: %s\n", file);
+
+  CHECK(fd >= 0);
+  CHECK(test_send(fd, &request, sizeof(request)));
+  CHECK(test_send(fd, file, strlen(file)));
+  CHECK(test_answer(fd, &answer));
+  CHECK(answer.response.status == 1);
+  CHECK(answer.response.output_length == 0);
+  CHECK(strcmp(answer.diagnostics, expected) == 0);
+
+  // and the next one is answered
+  request.input = SERVE_INPUT_SOURCE;
+  request.length = 1;
+  CHECK(test_send(fd, &request, sizeof(request)));
+  CHECK(test_send(fd, "a", 1));
+  CHECK(test_answer(fd, &answer));
+  CHECK(answer.response.status == 0);
+  CHECK(strcmp(answer.output, "IDENTIFIER a null\nEOF  null\n") == 0);
+
+  close(fd);
+}
+
+// a request that doesn't check out gets status 1 and ends the connection
+static void test_refused(const char *path, struct serve_request_t request) {
+  int fd = test_connect(path);
+  struct answer_t answer;
+
+  CHECK(fd >= 0);
+  CHECK(test_send(fd, &request, sizeof(request)));
+  CHECK(test_answer(fd, &answer));
+  CHECK(answer.response.status == 1);
+  CHECK(answer.response.output_length == 0);
+  CHECK(strcmp(answer.diagnostics, "Malformed request\n") == 0);
+  CHECK(test_closed(fd));
+
+  close(fd);
+}
+
+static void test_malformed(const char *path) {
+  struct serve_request_t request = {
+      .magic = SERVE_RESPONSE_MAGIC,
+      .input = SERVE_INPUT_SOURCE,
+  };
+
+  test_refused(path, request);
+
+  request.magic = SERVE_REQUEST_MAGIC;
+  request.input = SERVE_INPUT_SOURCE + 1;
+  test_refused(path, request);
+
+  request.input = SERVE_INPUT_SOURCE;
+  request.emit = SERVE_EMIT_BINARY + 1;
+  test_refused(path, request);
+}
+
+// refused from the header alone, the payload is never sent
+static void test_oversize(const char *path) {
+  struct serve_request_t request = {
+      .magic = SERVE_REQUEST_MAGIC,
+      .input = SERVE_INPUT_SOURCE,
+      .length = SERVE_MAX_PAYLOAD + 1,
+  };
+
+  test_refused(path, request);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: serve_test INTERPRETER\n");
+    return 1;
+  }
+
+  char directory[] = "/tmp/serve_test.XXXXXX";
+
+  if (mkdtemp(directory) == NULL) {
+    fprintf(stderr, "serve_test: cannot create a directory for the socket\n");
+    return 1;
+  }
+
+  char path[sizeof(directory) + 8];
+  snprintf(path, sizeof(path), "%s/socket", directory);
+
+  pid_t server = fork();
+
+  if (server < 0) {
+    fprintf(stderr, "serve_test: cannot start the server\n");
+    rmdir(directory);
+    return 1;
+  }
+
+  if (server == 0) {
+    execl(argv[1], argv[1], "serve", "--socket", path, "--threads", "2",
+          (char *)NULL);
+    _exit(127);
+  }
+
+  if (test_wait_for_server(path)) {
+    test_source(path);
+    test_not_a_file(path, "-");
+    test_not_a_file(path, directory);
+    test_malformed(path);
+    test_oversize(path);
+  } else {
+    fprintf(stderr, "serve_test: the server didn't start\n");
+    failures++;
+  }
+
+  // a clean stop removes the socket
+  int status = 0;
+
+  kill(server, SIGTERM);
+  waitpid(server, &status, 0);
+
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  CHECK(access(path, F_OK) != 0);
+
+  unlink(path);
+  rmdir(directory);
+
+  return failures != 0;
+}
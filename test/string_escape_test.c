@@ -0,0 +1,252 @@
+#include "diagnostics.h"
+#include "parallel_parser.h"
+#include "parser.h"
+#include "token_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// escapes in string literals: the ones that must be refused, and strings
+// with escapes split across the parallel scanner's chunks, which it has to
+// leave to a sequential scan
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+// big enough for three chunks of PARALLEL_PARSER_MIN_CHUNK
+#define TEST_SOURCE_SIZE (3 * 1024 * 1024 + 4096)
+
+// where the long string opens and closes, around every split point of a two
+// or three way scan
+#define TEST_STRING_BEGIN (900 * 1024)
+#define TEST_STRING_END (2200 * 1024)
+
+static int failures = 0;
+
+struct scan_t {
+  struct parser_t *parser;
+  struct diagnostics_t *diagnostics;
+};
+
+static int scan(struct scan_t *scan, const char *source, uint64_t length,
+                uint32_t threads) {
+  scan->parser = parser_create(NULL);
+  scan->diagnostics = diagnostics_create();
+
+  if (scan->parser == NULL || scan->diagnostics == NULL) {
+    fprintf(stderr, "string_escape_test: cannot create a parser\n");
+    failures++;
+    return 0;
+  }
+
+  scan->parser->diagnostics = scan->diagnostics;
+  parallel_parser_parse(scan->parser, source, length, threads);
+
+  return 1;
+}
+
+static void scan_destroy(struct scan_t *scan) {
+  if (scan->parser != NULL)
+    parser_destroy(scan->parser);
+
+  if (scan->diagnostics != NULL)
+    diagnostics_destroy(scan->diagnostics);
+}
+
+static int same_literal(const char *source, const struct token_stream_t *a,
+                        const struct token_stream_t *b, uint64_t i) {
+  uint64_t a_length;
+  uint64_t b_length;
+  const char *a_text = token_string_literal(source, a->offsets[i],
+                                            a->lengths[i], a->values[i],
+                                            &a_length);
+  const char *b_text = token_string_literal(source, b->offsets[i],
+                                            b->lengths[i], b->values[i],
+                                            &b_length);
+
+  return a_length == b_length && memcmp(a_text, b_text, a_length) == 0;
+}
+
+static int same_scan(const char *source, const struct scan_t *a,
+                     const struct scan_t *b) {
+  const struct token_stream_t *x = a->parser->tokens;
+  const struct token_stream_t *y = b->parser->tokens;
+
+  if (x->size != y->size || a->parser->error != b->parser->error ||
+      a->diagnostics->length != b->diagnostics->length ||
+      (a->diagnostics->length != 0 &&
+       memcmp(a->diagnostics->text, b->diagnostics->text,
+              a->diagnostics->length) != 0)) {
+    return 0;
+  }
+
+  for (uint64_t i = 0; i < x->size; i++) {
+    if (x->types[i] != y->types[i] || x->offsets[i] != y->offsets[i] ||
+        x->lengths[i] != y->lengths[i]) {
+      return 0;
+    }
+
+    if (x->types[i] == STRING && !same_literal(source, x, y, i))
+      return 0;
+  }
+
+  return 1;
+}
+
+static void test_escape_errors(void) {
+  static const struct {
+    const char *source;
+    const char *literal;
+  } cases[] = {
+      // past the last code point
+      {"\"\\u{110000}\"", "\\u{110000}"},
+      // a surrogate, which UTF-8 can't carry
+      {"\"\\u{D800}\"", "\\u{D800}"},
+      {"\"\\u{DFFF}\"", "\\u{DFFF}"},
+      // no closing brace, or nothing in the braces
+      {"\"\\u{41\"", "\\u{41"},
+      {"\"\\u{\"", "\\u{"},
+      {"\"\\u{1234567}\"", "\\u{1234567}"},
+      {"\"\\u41\"", "\\u41"},
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    struct scan_t result = {0};
+    const char *source = cases[i].source;
+
+    if (!scan(&result, source, strlen(source), 1))
+      return;
+
+    const struct token_stream_t *tokens = result.parser->tokens;
+    uint64_t length = 0;
+    const char *literal = "";
+
+    CHECK(tokens->size == 2 && tokens->types[0] == STRING);
+
+    if (tokens->size == 2) {
+      literal = token_string_literal(source, tokens->offsets[0],
+                                     tokens->lengths[0], tokens->values[0],
+                                     &length);
+    }
+
+    // the bad escape is reported and kept as written
+    if (length != strlen(cases[i].literal) ||
+        memcmp(literal, cases[i].literal, length) != 0) {
+      fprintf(stderr, "string_escape_test: %s decoded to %.*s\n", source,
+              (int)length, literal);
+      failures++;
+    }
+
+    CHECK(result.parser->error);
+    CHECK(result.diagnostics->count == 1);
+    CHECK(result.diagnostics->length != 0 &&
+          strncmp(result.diagnostics->text,
+                  "[line 1] Error: Invalid Unicode escape.\n",
+                  result.diagnostics->length) == 0);
+
+    scan_destroy(&result);
+  }
+}
+
+// statements up to TEST_STRING_BEGIN, a string running over many lines up to
+// TEST_STRING_END with escape placed in it, then statements to the end
+static uint64_t build_source(char *source, const char *escape,
+                             uint64_t escape_at) {
+  static const char statement[] = "var a = b + 1.5;\n";
+  static const char line[] = "text of a long string\n";
+  uint64_t length = 0;
+
+  while (length + sizeof(statement) < TEST_STRING_BEGIN) {
+    memcpy(source + length, statement, sizeof(statement) - 1);
+    length += sizeof(statement) - 1;
+  }
+
+  source[length++] = '"';
+
+  while (length + sizeof(line) < TEST_STRING_END) {
+    if (escape != NULL && length >= escape_at) {
+      memcpy(source + length, escape, strlen(escape));
+      length += strlen(escape);
+      escape = NULL;
+    }
+
+    memcpy(source + length, line, sizeof(line) - 1);
+    length += sizeof(line) - 1;
+  }
+
+  source[length++] = '"';
+  source[length++] = ';';
+  source[length++] = '\n';
+
+  while (length + sizeof(statement) < TEST_SOURCE_SIZE) {
+    memcpy(source + length, statement, sizeof(statement) - 1);
+    length += sizeof(statement) - 1;
+  }
+
+  return length;
+}
+
+static void check_parallel(const char *source, uint64_t length,
+                           const char *name) {
+  struct scan_t sequential = {0};
+
+  if (!scan(&sequential, source, length, 1))
+    return;
+
+  for (uint32_t threads = 2; threads <= 3; threads++) {
+    struct scan_t parallel = {0};
+
+    if (scan(&parallel, source, length, threads) &&
+        !same_scan(source, &sequential, &parallel)) {
+      fprintf(stderr,
+              "string_escape_test: %s on %u threads differs from a "
+              "sequential scan\n",
+              name, threads);
+      failures++;
+    }
+
+    scan_destroy(&parallel);
+  }
+
+  scan_destroy(&sequential);
+}
+
+static void test_parallel_fallback(void) {
+  char *source = (char *)malloc(TEST_SOURCE_SIZE);
+
+  if (source == NULL) {
+    fprintf(stderr, "string_escape_test: cannot allocate the source\n");
+    failures++;
+    return;
+  }
+
+  uint64_t length = build_source(source, NULL, 0);
+  check_parallel(source, length, "a plain string");
+
+  // in the part of the string before every split
+  length = build_source(source, "\\t\\u{1F600}", TEST_STRING_BEGIN + 64);
+  check_parallel(source, length, "an escape at the start");
+
+  // in the part the closing chunk scans itself
+  length = build_source(source, "\\\"\\u{e9}", TEST_STRING_END - 1024);
+  check_parallel(source, length, "an escape at the end");
+
+  // one that's refused, whose diagnostic has to come out the same
+  length = build_source(source, "\\u{D800}", TEST_STRING_END - 1024);
+  check_parallel(source, length, "a bad escape");
+
+  free(source);
+}
+
+int main(void) {
+  test_escape_errors();
+  test_parallel_fallback();
+
+  return failures != 0;
+}
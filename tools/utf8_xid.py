@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+# regenerates src/utf8_xid.c, the XID_Start and XID_Continue ranges the
+# scanner checks non-ASCII identifier characters against:
+#
+#   python3 tools/utf8_xid.py > src/utf8_xid.c
+#
+# the properties come from the running Python's Unicode database, through
+# str.isidentifier (which is defined in terms of exactly these two)
+
+import sys
+import unicodedata
+
+
+def ranges(accepts):
+    found = []
+    start = None
+
+    for code_point in range(0x80, sys.maxunicode + 2):
+        inside = code_point <= sys.maxunicode and accepts(chr(code_point))
+
+        if inside and start is None:
+            start = code_point
+        elif not inside and start is not None:
+            found.append((start, code_point - 1))
+            start = None
+
+    return found
+
+
+def emit(name, found):
+    print(f"const struct utf8_range_t {name}[] = {{")
+
+    # as many to a line as fit in 80 columns
+    line = "   "
+
+    for first, last in found:
+        entry = f" {{0x{first:04X}, 0x{last:04X}}},"
+
+        if len(line) + len(entry) > 80:
+            print(line)
+            line = "   "
+
+        line += entry
+
+    print(line)
+    print("};")
+    print()
+    print(f"const uint32_t {name}_count = {len(found)};")
+
+
+def main():
+    # '_' is the only non-XID_Start character isidentifier lets through
+    # first, and it's ASCII
+    start = ranges(lambda c: c.isidentifier())
+    cont = ranges(lambda c: ("a" + c).isidentifier())
+
+    print(f"// generated by tools/utf8_xid.py from Unicode "
+          f"{unicodedata.unidata_version}, don't edit")
+    print()
+    print('#include "utf8.h"')
+    print()
+    emit("utf8_xid_start", start)
+    print()
+    emit("utf8_xid_continue", cont)
+
+
+if __name__ == "__main__":
+    main()